@@ -0,0 +1,324 @@
+#pragma once
+#include <cctype>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <stdexcept>
+
+#include "STLNonManifold.h"
+#include "StreamingChecker.h"
+#include "ResultCache.h"
+
+/*
+	批量检查：对一个目录、通配符或清单文件中的所有stl文件，在工作线程池中同时检查
+
+	- 目录：目录下（不递归）所有扩展名为.stl或.stl.gz的文件
+	- 通配符：文件名部分含*或?，如 "*.stl"
+	- 清单文件：每行一个stl路径，空行与#开头的行忽略，相对路径相对于清单文件所在目录
+	单个文件读取或检查失败只记录在该文件的结果中，不影响其余文件
+*/
+
+namespace STLNonManifold {
+
+	namespace Batch {
+
+		/*
+			单个文件的检查结果
+		*/
+		struct FileResult {
+			std::string stlFile;
+			bool ok = false;
+			std::string error;
+
+			long long verticesCount = 0;
+			long long edgesCount = 0;
+			long long trianglesCount = 0;
+			long long nonManifoldCount = 0;
+			long long nonManifoldVerticesCount = 0; // 流式检查不检查非流形顶点，为-1
+			long long inconsistentEdgesCount = 0; // 方向不一致的边，流式检查不检查，为-1
+
+			double loadTimeMs = 0.0; // 流式检查不单独统计读取时间
+			double totalTimeMs = 0.0;
+			bool cacheHit = false; // 结果来自缓存（options.cacheDirectory）
+		};
+
+		inline std::string ToLower(std::string s) {
+			std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+			return s;
+		}
+
+		inline bool HasStlExtension(const std::filesystem::path& file_path) {
+			std::string extension = ToLower(file_path.extension().string());
+			if (extension == ".gz") {
+				extension = ToLower(file_path.stem().extension().string());
+			}
+			return extension == ".stl";
+		}
+
+		/*
+			通配符匹配，*匹配任意个字符，?匹配一个字符
+		*/
+		inline bool WildcardMatch(const char* pattern, const char* str) {
+			const char* star = nullptr;
+			const char* star_str = nullptr;
+			while (*str) {
+				if (*pattern == '?' || *pattern == *str) {
+					pattern++;
+					str++;
+				}
+				else if (*pattern == '*') {
+					star = pattern++;
+					star_str = str;
+				}
+				else if (star) {
+					pattern = star + 1;
+					str = ++star_str;
+				}
+				else {
+					return false;
+				}
+			}
+			while (*pattern == '*') {
+				pattern++;
+			}
+			return *pattern == '\0';
+		}
+
+		/*
+			按输入（目录、通配符或清单文件）列出要检查的stl文件，目录与通配符的结果按路径排序
+		*/
+		inline std::vector<std::string> CollectStlFiles(const std::string& input) {
+			namespace fs = std::filesystem;
+
+			std::vector<std::string> stl_files;
+			fs::path input_path(input);
+
+			if (fs::is_directory(input_path)) {
+				for (auto&& entry : fs::directory_iterator(input_path)) {
+					if (entry.is_regular_file() && HasStlExtension(entry.path())) {
+						stl_files.emplace_back(entry.path().string());
+					}
+				}
+				std::sort(stl_files.begin(), stl_files.end());
+				return stl_files;
+			}
+
+			std::string file_name = input_path.filename().string();
+			if (file_name.find_first_of("*?") != std::string::npos) {
+				fs::path directory = input_path.parent_path();
+				if (directory.empty()) {
+					directory = ".";
+				}
+				if (!fs::is_directory(directory)) {
+					throw std::runtime_error("Batch directory not found: " + directory.string());
+				}
+
+				for (auto&& entry : fs::directory_iterator(directory)) {
+					if (entry.is_regular_file() && WildcardMatch(file_name.c_str(), entry.path().filename().string().c_str())) {
+						stl_files.emplace_back(entry.path().string());
+					}
+				}
+				std::sort(stl_files.begin(), stl_files.end());
+				return stl_files;
+			}
+
+			// 清单文件
+			std::ifstream manifest(input_path);
+			if (!manifest.is_open()) {
+				throw std::runtime_error("Open batch input failed: " + input);
+			}
+
+			std::string line;
+			while (std::getline(manifest, line)) {
+				// 去掉首尾空白（包括Windows换行的\r）
+				size_t begin = line.find_first_not_of(" \t\r");
+				if (begin == std::string::npos || line[begin] == '#') {
+					continue;
+				}
+				size_t end = line.find_last_not_of(" \t\r");
+
+				fs::path stl_path(line.substr(begin, end - begin + 1));
+				if (stl_path.is_relative()) {
+					stl_path = input_path.parent_path() / stl_path;
+				}
+				stl_files.emplace_back(stl_path.string());
+			}
+			return stl_files;
+		}
+
+		/*
+			检查单个文件，异常记录在结果中
+		*/
+		inline FileResult CheckFile(const std::string& stl_file, const CheckerOptions& options, bool streaming) {
+			FileResult result;
+			result.stlFile = stl_file;
+
+			auto start = std::chrono::steady_clock::now();
+			try {
+				if (!std::filesystem::is_regular_file(stl_file)) {
+					throw std::runtime_error("File not found.");
+				}
+
+				if (streaming) {
+					StreamingNonManifoldChecker checker(stl_file, options);
+					result.verticesCount = checker.verticesCount;
+					result.edgesCount = checker.edgesCount;
+					result.trianglesCount = checker.trianglesCount;
+					result.nonManifoldCount = checker.nonManifoldCount;
+					result.nonManifoldVerticesCount = -1;
+					result.inconsistentEdgesCount = -1;
+				}
+				else {
+					// 缓存命中时个数来自文件头，方向不一致的边由缓存的拓扑统计
+					Cache::CacheKey cache_key;
+					Cache::CachedResult cached;
+					if (!options.cacheDirectory.empty()) {
+						cache_key = Cache::MakeKey(stl_file, options);
+						result.cacheHit = cached.Open(Cache::CacheFilePath(options.cacheDirectory, cache_key), cache_key);
+					}
+
+					if (result.cacheHit) {
+						result.verticesCount = cached.header.verticesCount;
+						result.edgesCount = cached.header.edgesCount;
+						result.trianglesCount = cached.header.trianglesCount;
+						result.nonManifoldCount = cached.header.nonManifoldCount;
+						result.nonManifoldVerticesCount = cached.header.nonManifoldVerticesCount;
+						result.inconsistentEdgesCount = cached.CountInconsistentEdges();
+					}
+					else {
+						STLNonManifoldChecker checker(stl_file, options);
+						result.verticesCount = checker.verticesCount;
+						result.edgesCount = checker.edgesCount;
+						result.trianglesCount = checker.trianglesCount;
+						result.nonManifoldCount = checker.CountNonManifold();
+						result.nonManifoldVerticesCount = checker.CountNonManifoldVertices();
+						result.inconsistentEdgesCount = checker.CountInconsistentEdges();
+						result.loadTimeMs = checker.loadTimeMs;
+
+						if (!options.cacheDirectory.empty()) {
+							Cache::Store(Cache::CacheFilePath(options.cacheDirectory, cache_key), cache_key, checker);
+						}
+					}
+				}
+				result.ok = true;
+			}
+			catch (const std::exception& e) {
+				result.error = e.what();
+			}
+			catch (...) {
+				result.error = "Unknown error.";
+			}
+			result.totalTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			return result;
+		}
+
+		/*
+			num_workers个工作线程依次领取文件进行检查，结果按输入顺序返回
+			每个文件内部的读取使用options.numThreads个线程
+		*/
+		inline std::vector<FileResult> CheckFiles(const std::vector<std::string>& stl_files, const CheckerOptions& options, unsigned int num_workers, bool streaming) {
+			std::vector<FileResult> results(stl_files.size());
+			std::atomic<size_t> next_file(0);
+
+			auto worker = [&]() {
+				for (size_t i = next_file++; i < stl_files.size(); i = next_file++) {
+					results[i] = CheckFile(stl_files[i], options, streaming);
+
+					LOG_INFO("Batch: %s %s", results[i].ok ? "ok" : "failed", stl_files[i].c_str());
+				}
+			};
+
+			num_workers = std::max(1u, std::min<unsigned int>(num_workers, static_cast<unsigned int>(stl_files.size())));
+			std::vector<std::thread> threads;
+			for (unsigned int i = 1; i < num_workers; i++) {
+				threads.emplace_back(worker);
+			}
+			worker();
+			for (auto&& t : threads) {
+				t.join();
+			}
+
+			return results;
+		}
+
+		/*
+			CSV字段中含逗号、引号或换行时加引号
+		*/
+		inline std::string CsvField(const std::string& field) {
+			if (field.find_first_of(",\"\r\n") == std::string::npos) {
+				return field;
+			}
+			std::string quoted = "\"";
+			for (char c : field) {
+				if (c == '"') {
+					quoted += '"';
+				}
+				quoted += c;
+			}
+			return quoted + "\"";
+		}
+
+		/*
+			写出CSV汇总，每个文件一行
+		*/
+		inline void WriteSummary(const std::vector<FileResult>& results, const std::string& summary_path) {
+			std::ofstream f(summary_path, std::ios::out | std::ios::trunc);
+			if (!f.is_open()) {
+				throw std::runtime_error("Open batch summary failed: " + summary_path);
+			}
+
+			f << "file,status,vertices,edges,triangles,non_manifold,non_manifold_vertices,inconsistent_edges,load_ms,total_ms,error\n";
+			for (auto&& result : results) {
+				f << CsvField(result.stlFile) << "," << (result.ok ? "ok" : "failed") << ","
+					<< result.verticesCount << "," << result.edgesCount << "," << result.trianglesCount << "," << result.nonManifoldCount << "," << result.nonManifoldVerticesCount << "," << result.inconsistentEdgesCount << ","
+					<< result.loadTimeMs << "," << result.totalTimeMs << "," << CsvField(result.error) << "\n";
+			}
+		}
+
+		/*
+			在控制台输出汇总
+		*/
+		inline void PrintSummary(const std::vector<FileResult>& results, double wall_time_ms) {
+			size_t failed_count = 0;
+			size_t non_manifold_files = 0;
+			size_t cache_hits = 0;
+			for (auto&& result : results) {
+				if (result.cacheHit) {
+					cache_hits++;
+				}
+				if (!result.ok) {
+					failed_count++;
+					std::cout << "FAILED " << result.stlFile << ": " << result.error << std::endl;
+				}
+				else if (result.nonManifoldCount > 0 || result.nonManifoldVerticesCount > 0) {
+					non_manifold_files++;
+					if (result.nonManifoldCount > 0) {
+						std::cout << "NonManifold " << result.nonManifoldCount << " " << result.stlFile << std::endl;
+					}
+					if (result.nonManifoldVerticesCount > 0) {
+						std::cout << "NonManifold Vertex " << result.nonManifoldVerticesCount << " " << result.stlFile << std::endl;
+					}
+				}
+				if (result.ok && result.inconsistentEdgesCount > 0) {
+					std::cout << "Inconsistent Orientation " << result.inconsistentEdgesCount << " " << result.stlFile << std::endl;
+				}
+			}
+
+			std::cout << "Files: " << results.size() << ", failed: " << failed_count << ", with NonManifold: " << non_manifold_files
+				<< ", wall time: " << wall_time_ms << " ms" << std::endl;
+			if (cache_hits > 0) {
+				std::cout << "Cache hits: " << cache_hits << std::endl;
+			}
+		}
+
+	}
+
+} // namespace STLNonManifold
@@ -0,0 +1,621 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+
+#include "STLNonManifold.h"
+
+namespace STLNonManifold {
+
+	namespace Benchmark {
+
+		/*
+			重复执行func，返回最快一次的耗时（ms）
+		*/
+		inline double MeasureMs(const std::function<void()>& func, int repeats) {
+			double best_ms = 0.0;
+			for (int i = 0; i < repeats; i++) {
+				auto start = std::chrono::steady_clock::now();
+				func();
+				double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				if (i == 0 || ms < best_ms) {
+					best_ms = ms;
+				}
+			}
+			return best_ms;
+		}
+
+		inline void PrintResult(const std::string& name, double ms, double base_ms) {
+			std::cout << "  " << name << ": " << ms << " ms";
+			if (ms > 0.0) {
+				std::cout << " (x" << base_ms / ms << ")";
+			}
+			std::cout << std::endl;
+		}
+
+		/*
+			比较StlMesh读取（去重 / 三角形汤）与内存映射读取二进制文件（到取出全部角点坐标为止）的耗时
+		*/
+		inline void CompareLoad(const std::string& stl_file, const CheckerOptions& options, int repeats) {
+			std::cout << "[load] " << stl_file << std::endl;
+
+			std::vector<STLNonManifold::Geometry::Coordinate> stream_coords, soup_coords, mapped_coords;
+
+			double stream_ms = MeasureMs([&]() {
+				StlMeshType mesh;
+				mesh.read_file(stl_file, options.numThreads);
+				stream_coords = CollectCoordinates(mesh);
+			}, repeats);
+
+			double soup_ms = MeasureMs([&]() {
+				StlMeshType mesh;
+				mesh.read_file_soup(stl_file, options.numThreads);
+				soup_coords = CollectCoordinates(mesh);
+			}, repeats);
+
+			// 内存映射只支持二进制文件
+			bool is_binary = !stl_reader::StlFileIsGzip(stl_file.c_str()) && !stl_reader::StlFileHasASCIIFormat(stl_file.c_str());
+			double mapped_ms = 0.0;
+			if (is_binary) {
+				mapped_ms = MeasureMs([&]() {
+					StlBinaryViewType view(stl_file);
+					mapped_coords = CollectCoordinates(view);
+				}, repeats);
+			}
+			else {
+				mapped_coords = stream_coords;
+			}
+
+			auto same_coords = [](const std::vector<STLNonManifold::Geometry::Coordinate>& a, const std::vector<STLNonManifold::Geometry::Coordinate>& b) {
+				return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+					[](const STLNonManifold::Geometry::Coordinate& c1, const STLNonManifold::Geometry::Coordinate& c2) {
+						return c1[0] == c2[0] && c1[1] == c2[1] && c1[2] == c2[2];
+					});
+			};
+			bool same = same_coords(stream_coords, soup_coords) && same_coords(stream_coords, mapped_coords);
+
+			std::cout << "  coordinates: " << mapped_coords.size() << (same ? ", identical" : ", MISMATCH") << std::endl;
+			PrintResult("StlMesh", stream_ms, stream_ms);
+			PrintResult("StlMesh (soup)", soup_ms, stream_ms);
+			if (is_binary) {
+				PrintResult("StlBinaryView", mapped_ms, stream_ms);
+			}
+		}
+
+		/*
+			ASCII stl读取的原始数组
+		*/
+		struct StlArrays {
+			std::vector<STLNonManifold::Geometry::T_NUM> coords, normals;
+			std::vector<unsigned int> tris, solids;
+
+			bool operator==(const StlArrays& other) const {
+				return coords == other.coords && normals == other.normals && tris == other.tris && solids == other.solids;
+			}
+		};
+
+		inline double FileSizeMB(const std::string& file_path) {
+			std::ifstream in(file_path, std::ios::binary | std::ios::ate);
+			return static_cast<double>(in.tellg()) / (1024.0 * 1024.0);
+		}
+
+		inline void PrintThroughput(const std::string& name, double ms, double base_ms, double size_mb) {
+			std::cout << "  " << name << ": " << ms << " ms, " << size_mb / (ms / 1000.0) << " MB/s";
+			if (ms > 0.0) {
+				std::cout << " (x" << base_ms / ms << ")";
+			}
+			std::cout << std::endl;
+		}
+
+		/*
+			比较istringstream/atof的ASCII读取与基于缓冲区扫描的ASCII读取
+		*/
+		inline void CompareAsciiParser(const std::string& stl_file, const CheckerOptions& options, int repeats) {
+			std::cout << "[ascii] " << stl_file << std::endl;
+
+			if (!stl_reader::StlFileHasASCIIFormat(stl_file.c_str())) {
+				std::cout << "  skipped: not an ASCII stl file" << std::endl;
+				return;
+			}
+
+			double size_mb = FileSizeMB(stl_file);
+			StlArrays stream_arrays, buffer_arrays;
+
+			double stream_ms = MeasureMs([&]() {
+				stl_reader::ReadStlFile_ASCII_Stream(stl_file.c_str(), stream_arrays.coords, stream_arrays.normals, stream_arrays.tris, stream_arrays.solids);
+			}, repeats);
+
+			double buffer_ms = MeasureMs([&]() {
+				stl_reader::ReadStlFile_ASCII(stl_file.c_str(), buffer_arrays.coords, buffer_arrays.normals, buffer_arrays.tris, buffer_arrays.solids);
+			}, repeats);
+
+			std::cout << "  triangles: " << buffer_arrays.tris.size() / 3 << ", solids: " << (buffer_arrays.solids.empty() ? 0 : buffer_arrays.solids.size() - 1)
+				<< (stream_arrays == buffer_arrays ? ", identical" : ", MISMATCH") << std::endl;
+			PrintThroughput("ReadStlFile_ASCII_Stream", stream_ms, stream_ms, size_mb);
+			PrintThroughput("ReadStlFile_ASCII", buffer_ms, stream_ms, size_mb);
+
+			unsigned int num_threads = stl_reader::stl_reader_impl::ResolveNumThreads(options.numThreads);
+			if (num_threads > 1) {
+				StlArrays parallel_arrays;
+				double parallel_ms = MeasureMs([&]() {
+					stl_reader::ReadStlFile_ASCII(stl_file.c_str(), parallel_arrays.coords, parallel_arrays.normals, parallel_arrays.tris, parallel_arrays.solids, num_threads);
+				}, repeats);
+
+				std::cout << "  " << num_threads << " threads: " << (parallel_arrays == buffer_arrays ? "identical" : "MISMATCH") << std::endl;
+				PrintThroughput("ReadStlFile_ASCII (parallel)", parallel_ms, stream_ms, size_mb);
+			}
+		}
+
+		/*
+			比较RemoveDoubles中的比较排序与基数排序（单线程 / 多线程）去重的耗时
+		*/
+		inline void CompareDedup(const std::string& stl_file, const CheckerOptions& options, int repeats) {
+			std::cout << "[dedup] " << stl_file << std::endl;
+
+			typedef stl_reader::stl_reader_impl::CoordWithIndex<STLNonManifold::Geometry::T_NUM, unsigned int> CoordWithIndexType;
+
+			// 以三角形汤为输入，角点i的索引即为i
+			StlMeshType soup;
+			soup.read_file_soup(stl_file);
+			StlArrays input;
+			std::vector<CoordWithIndexType> coords_with_index(soup.num_vrts());
+			for (size_t i = 0; i < coords_with_index.size(); i++) {
+				for (size_t j = 0; j < 3; j++) {
+					coords_with_index[i][j] = soup.vrt_coords(i)[j];
+				}
+				coords_with_index[i].index = static_cast<unsigned int>(i);
+			}
+			input.tris.assign(soup.raw_tris(), soup.raw_tris() + soup.num_tris() * 3);
+			input.normals.assign(soup.raw_normals(), soup.raw_normals() + soup.num_tris() * 3);
+			input.solids.assign(soup.raw_solids(), soup.raw_solids() + soup.num_solids() + 1);
+
+			auto remove_doubles = [&](StlArrays& out, unsigned int num_threads, bool radix_sort) {
+				std::vector<CoordWithIndexType> work = coords_with_index;
+				out.normals = input.normals;
+				out.tris = input.tris;
+				out.solids = input.solids;
+				stl_reader::stl_reader_impl::RemoveDoubles(out.coords, out.tris, out.normals, out.solids, work, num_threads, radix_sort);
+			};
+
+			StlArrays sort_arrays, radix_arrays;
+			double sort_ms = MeasureMs([&]() { remove_doubles(sort_arrays, 1, false); }, repeats);
+			double radix_ms = MeasureMs([&]() { remove_doubles(radix_arrays, 1, true); }, repeats);
+
+			std::cout << "  corners: " << coords_with_index.size() << ", vertices: " << sort_arrays.coords.size() / 3
+				<< (sort_arrays == radix_arrays ? ", identical" : ", MISMATCH") << std::endl;
+			PrintResult("std::sort", sort_ms, sort_ms);
+			PrintResult("radix sort", radix_ms, sort_ms);
+
+			unsigned int num_threads = stl_reader::stl_reader_impl::ResolveNumThreads(options.numThreads);
+			if (num_threads > 1) {
+				StlArrays parallel_arrays;
+				double parallel_ms = MeasureMs([&]() { remove_doubles(parallel_arrays, num_threads, true); }, repeats);
+
+				std::cout << "  " << num_threads << " threads: " << (parallel_arrays == sort_arrays ? "identical" : "MISMATCH") << std::endl;
+				PrintResult("radix sort (parallel)", parallel_ms, sort_ms);
+			}
+		}
+
+		/*
+			比较指针节点的KDTree与数组存储的FlatKDTree：构造、对每个角点Match的耗时与内存
+		*/
+		inline void CompareKDTree(const std::string& stl_file, const CheckerOptions& options, int repeats) {
+			std::cout << "[kdtree] " << stl_file << std::endl;
+
+			typedef KDTree<STLNonManifold::Geometry::Coordinate, STLNonManifold::Geometry::T_NUM> KDTreeType;
+			typedef FlatKDTree<STLNonManifold::Geometry::Coordinate, STLNonManifold::Geometry::T_NUM> FlatKDTreeType;
+
+			StlMeshType soup;
+			soup.read_file_soup(stl_file, options.numThreads);
+			std::vector<STLNonManifold::Geometry::Coordinate> coordinates = CollectCoordinates(soup);
+			int coords_count = static_cast<int>(coordinates.size());
+
+			KDTreeType kdtree;
+			FlatKDTreeType flat_kdtree;
+			double build_ms = MeasureMs([&]() { kdtree.BuildTree(coordinates); }, repeats);
+			double flat_build_ms = MeasureMs([&]() { flat_kdtree.BuildTree(coordinates); }, repeats);
+
+			// 每个角点匹配到的最小id与匹配个数
+			auto match_all = [&](auto& tree, std::vector<int>& min_ids, long long& matched_count) {
+				min_ids.assign(coords_count, 0);
+				matched_count = 0;
+				for (int i = 0; i < coords_count; i++) {
+					auto same_coords = tree.Match(coordinates[i]);
+					int min_id = coords_count;
+					for (auto&& coord : same_coords) {
+						min_id = std::min(min_id, coord.GetId());
+					}
+					min_ids[i] = min_id;
+					matched_count += static_cast<long long>(same_coords.size());
+				}
+			};
+
+			std::vector<int> min_ids, flat_min_ids;
+			long long matched_count = 0, flat_matched_count = 0;
+			double match_ms = MeasureMs([&]() { match_all(kdtree, min_ids, matched_count); }, repeats);
+			double flat_match_ms = MeasureMs([&]() { match_all(flat_kdtree, flat_min_ids, flat_matched_count); }, repeats);
+
+			// 不分配内存的ForEachMatch，分别使用标量、SSE、AVX路径（CPU支持的）
+			std::vector<FlatKDTreeType::SimdLevel> simd_levels = { FlatKDTreeType::SimdLevel::SCALAR };
+			if (FlatKDTreeType::DetectSimdLevel() != FlatKDTreeType::SimdLevel::SCALAR) {
+				simd_levels.push_back(FlatKDTreeType::SimdLevel::SSE);
+			}
+			if (FlatKDTreeType::DetectSimdLevel() == FlatKDTreeType::SimdLevel::AVX) {
+				simd_levels.push_back(FlatKDTreeType::SimdLevel::AVX);
+			}
+
+			bool same = min_ids == flat_min_ids && matched_count == flat_matched_count;
+			std::vector<double> visitor_match_ms;
+			for (auto simd_level : simd_levels) {
+				flat_kdtree.simdLevel = simd_level;
+
+				std::vector<int> visitor_min_ids(coords_count);
+				long long visitor_matched_count = 0;
+				visitor_match_ms.push_back(MeasureMs([&]() {
+					visitor_matched_count = 0;
+					for (int i = 0; i < coords_count; i++) {
+						int min_id = coords_count;
+						flat_kdtree.ForEachMatch(coordinates[i], [&](int j) {
+							min_id = std::min(min_id, flat_kdtree.points[j].GetId());
+							visitor_matched_count++;
+						});
+						visitor_min_ids[i] = min_id;
+					}
+				}, repeats));
+
+				same = same && min_ids == visitor_min_ids && matched_count == visitor_matched_count;
+			}
+			flat_kdtree.simdLevel = FlatKDTreeType::DetectSimdLevel();
+
+			// KDTree每个点一个叶子节点，共2n-1个节点（不计堆分配的额外开销）
+			double mb = 1024.0 * 1024.0;
+			double kdtree_mb = coords_count > 0 ? (2.0 * coords_count - 1.0) * sizeof(KDTreeType::KDTreeNode) / mb : 0.0;
+			double flat_kdtree_mb = flat_kdtree.MemoryBytes() / mb;
+
+			std::cout << "  points: " << coords_count << ", matches: " << flat_matched_count << (same ? ", identical" : ", MISMATCH") << std::endl;
+			std::cout << "  memory: KDTree " << kdtree_mb << " MB, FlatKDTree " << flat_kdtree_mb << " MB (" << flat_kdtree.nodes.size() << " nodes)" << std::endl;
+			PrintResult("KDTree build", build_ms, build_ms);
+			PrintResult("FlatKDTree build", flat_build_ms, build_ms);
+			PrintResult("KDTree Match", match_ms, match_ms);
+			PrintResult("FlatKDTree Match", flat_match_ms, match_ms);
+			const char* simd_level_names[] = { "scalar", "SSE", "AVX" };
+			for (size_t i = 0; i < simd_levels.size(); i++) {
+				std::string name = std::string("FlatKDTree ForEachMatch (") + simd_level_names[static_cast<int>(simd_levels[i])] + ")";
+				PrintResult(name, visitor_match_ms[i], match_ms);
+				std::cout << "    " << coords_count / (visitor_match_ms[i] * 1000.0) << " M queries/s" << std::endl;
+			}
+
+			// FlatKDTree并行构造：1, 2, 4, ...直到-j个线程，与单线程构造的树比较
+			auto same_tree = [](const FlatKDTreeType& a, const FlatKDTreeType& b) {
+				auto same_node = [](const FlatKDTreeType::FlatKDTreeNode& n1, const FlatKDTreeType::FlatKDTreeNode& n2) {
+					return std::equal(n1.minRange, n1.minRange + 3, n2.minRange) && std::equal(n1.maxRange, n1.maxRange + 3, n2.maxRange)
+						&& n1.begin == n2.begin && n1.end == n2.end && n1.rightNode == n2.rightNode;
+				};
+				auto same_point = [](const STLNonManifold::Geometry::Coordinate& c1, const STLNonManifold::Geometry::Coordinate& c2) {
+					return c1[0] == c2[0] && c1[1] == c2[1] && c1[2] == c2[2] && c1.GetId() == c2.GetId();
+				};
+				return a.nodes.size() == b.nodes.size() && std::equal(a.nodes.begin(), a.nodes.end(), b.nodes.begin(), same_node)
+					&& a.points.size() == b.points.size() && std::equal(a.points.begin(), a.points.end(), b.points.begin(), same_point);
+			};
+
+			unsigned int max_threads = stl_reader::stl_reader_impl::ResolveNumThreads(options.numThreads);
+			std::vector<unsigned int> threads_counts;
+			for (unsigned int num_threads = 2; num_threads < max_threads; num_threads *= 2) {
+				threads_counts.push_back(num_threads);
+			}
+			if (max_threads > 1) {
+				threads_counts.push_back(max_threads);
+			}
+
+			for (unsigned int num_threads : threads_counts) {
+				FlatKDTreeType parallel_kdtree;
+				double parallel_ms = MeasureMs([&]() { parallel_kdtree.BuildTree(coordinates, num_threads); }, repeats);
+				std::cout << "  " << num_threads << " threads: " << (same_tree(parallel_kdtree, flat_kdtree) ? "identical" : "MISMATCH") << std::endl;
+				PrintResult("FlatKDTree build (parallel)", parallel_ms, flat_build_ms);
+			}
+		}
+
+		/*
+			比较KDTree、空间哈希网格与Morton网格三种合并坐标方式（单线程 / 多线程无锁并查集）的耗时，并检查合并结果是否相同
+		*/
+		inline void CompareWeld(const std::string& stl_file, const CheckerOptions& options, int repeats) {
+			std::cout << "[weld] " << stl_file << std::endl;
+
+			StlMeshType soup;
+			soup.read_file_soup(stl_file, options.numThreads);
+			std::vector<STLNonManifold::Geometry::Coordinate> coordinates = CollectCoordinates(soup);
+
+			std::vector<int> kdtree_indices, grid_indices, morton_indices;
+			double kdtree_ms = MeasureMs([&]() { kdtree_indices = WeldCoordinates(coordinates, WeldMethod::KDTREE, 1); }, repeats);
+			double grid_ms = MeasureMs([&]() { grid_indices = WeldCoordinates(coordinates, WeldMethod::HASH_GRID, 1); }, repeats);
+			double morton_ms = MeasureMs([&]() { morton_indices = WeldCoordinates(coordinates, WeldMethod::MORTON, 1); }, repeats);
+
+			size_t vertices_count = 0;
+			for (size_t i = 0; i < grid_indices.size(); i++) {
+				if (grid_indices[i] == static_cast<int>(i)) {
+					vertices_count++;
+				}
+			}
+
+			std::cout << "  points: " << coordinates.size() << ", vertices: " << vertices_count << (kdtree_indices == grid_indices && morton_indices == grid_indices ? ", identical" : ", MISMATCH") << std::endl;
+			PrintResult("KDTree", kdtree_ms, kdtree_ms);
+			PrintResult("hash grid", grid_ms, kdtree_ms);
+			PrintResult("Morton grid", morton_ms, kdtree_ms);
+
+			unsigned int num_threads = stl_reader::stl_reader_impl::ResolveNumThreads(options.numThreads);
+			if (num_threads > 1) {
+				std::vector<int> parallel_kdtree_indices, parallel_grid_indices, parallel_morton_indices;
+				double parallel_kdtree_ms = MeasureMs([&]() { parallel_kdtree_indices = WeldCoordinates(coordinates, WeldMethod::KDTREE, num_threads); }, repeats);
+				double parallel_grid_ms = MeasureMs([&]() { parallel_grid_indices = WeldCoordinates(coordinates, WeldMethod::HASH_GRID, num_threads); }, repeats);
+				double parallel_morton_ms = MeasureMs([&]() { parallel_morton_indices = WeldCoordinates(coordinates, WeldMethod::MORTON, num_threads); }, repeats);
+
+				bool same = parallel_kdtree_indices == grid_indices && parallel_grid_indices == grid_indices && parallel_morton_indices == grid_indices;
+				std::cout << "  " << num_threads << " threads: " << (same ? "identical" : "MISMATCH") << std::endl;
+				PrintResult("KDTree (parallel)", parallel_kdtree_ms, kdtree_ms);
+				PrintResult("hash grid (parallel)", parallel_grid_ms, kdtree_ms);
+				PrintResult("Morton grid (parallel)", parallel_morton_ms, kdtree_ms);
+			}
+		}
+
+		/*
+			比较shared_ptr连接的拓扑图（BuildTopologyGraph）与IndexMesh（BuildIndexMesh，单线程 / 多线程）的构造耗时与内存，合并只做一次，不计入耗时
+		*/
+		inline void CompareTopology(const std::string& stl_file, const CheckerOptions& options, int repeats) {
+			std::cout << "[topology] " << stl_file << std::endl;
+
+			StlMeshType soup;
+			soup.read_file_soup(stl_file, options.numThreads);
+			std::vector<STLNonManifold::Geometry::Coordinate> coordinates = CollectCoordinates(soup);
+
+			std::vector<int> vertex_order;
+			std::vector<int> coordinates_indices = WeldCoordinatesForTopology(coordinates, options, vertex_order);
+
+			// 析构（拓扑图需要先断开引用环）计入构造的耗时
+			size_t graph_bytes = 0;
+			double graph_ms = MeasureMs([&]() {
+				TopologyGraph graph = BuildTopologyGraph(coordinates, coordinates_indices, vertex_order);
+				graph_bytes = graph.MemoryBytes();
+			}, repeats);
+
+			STLNonManifold::Geometry::IndexMesh topology;
+			double index_ms = MeasureMs([&]() { topology = BuildIndexMesh(coordinates, coordinates_indices, vertex_order); }, repeats);
+
+			// 两者的编号相同：逐条边比较端点与关联三角形
+			TopologyGraph graph = BuildTopologyGraph(coordinates, coordinates_indices, vertex_order);
+			bool same = graph.verticesCount == topology.VerticesCount() && graph.edgesCount == topology.EdgesCount()
+				&& static_cast<int>(graph.triangles.size()) == topology.TrianglesCount();
+			for (size_t t = 0; same && t < graph.triangles.size(); t++) {
+				for (int j = 0; j < 3; j++) {
+					const auto& edge_ptr = graph.triangles[t]->edges[j];
+					int e = topology.TriangleEdge(static_cast<int>(t), j);
+					same = same && edge_ptr->id == e && edge_ptr->start->id == topology.EdgeStart(e) && edge_ptr->end->id == topology.EdgeEnd(e)
+						&& static_cast<int>(edge_ptr->incident_triangles.size()) == topology.IncidentTrianglesCount(e);
+				}
+			}
+
+			std::cout << "  vertices: " << topology.VerticesCount() << ", edges: " << topology.EdgesCount() << ", triangles: " << topology.TrianglesCount()
+				<< (same ? ", identical" : ", MISMATCH") << std::endl;
+			std::cout << "  memory: shared_ptr graph " << graph_bytes / (1024.0 * 1024.0) << " MB, IndexMesh " << topology.MemoryBytes() / (1024.0 * 1024.0) << " MB" << std::endl;
+			PrintResult("shared_ptr graph", graph_ms, graph_ms);
+			PrintResult("IndexMesh", index_ms, graph_ms);
+
+			unsigned int num_threads = stl_reader::stl_reader_impl::ResolveNumThreads(options.numThreads);
+			if (num_threads > 1) {
+				STLNonManifold::Geometry::IndexMesh parallel_topology;
+				double parallel_ms = MeasureMs([&]() { parallel_topology = BuildIndexMesh(coordinates, coordinates_indices, vertex_order, num_threads); }, repeats);
+
+				bool same_topology = parallel_topology.vertexCoords == topology.vertexCoords && parallel_topology.triangleEdges == topology.triangleEdges
+					&& parallel_topology.triangleSenses == topology.triangleSenses && parallel_topology.edgeVertices == topology.edgeVertices
+					&& parallel_topology.incidenceBegin == topology.incidenceBegin && parallel_topology.incidenceTriangles == topology.incidenceTriangles;
+				std::cout << "  " << num_threads << " threads: " << (same_topology ? "identical" : "MISMATCH") << std::endl;
+				PrintResult("IndexMesh (parallel)", parallel_ms, graph_ms);
+			}
+		}
+
+		/*
+			自相交检查：构造TriangleBVH与遍历检查三角形对的耗时，与两两比较（只在三角形数不超过BRUTE_FORCE_TRIANGLES时）的结果比较，
+			-j时再比较多线程的结果
+		*/
+		inline void CompareSelfIntersection(const std::string& stl_file, const CheckerOptions& options, int repeats) {
+			std::cout << "[intersect] " << stl_file << std::endl;
+
+			const int BRUTE_FORCE_TRIANGLES = 20000;
+
+			CheckerOptions serial_options = options;
+			serial_options.numThreads = 1;
+			STLNonManifoldChecker checker(stl_file, serial_options);
+			const STLNonManifold::Geometry::IndexMesh& topology = checker.topology;
+
+			SelfIntersectionTester tester(topology);
+			size_t bvh_bytes = 0;
+			double build_ms = MeasureMs([&]() {
+				TriangleBVH bvh(topology.vertexCoords.data(), tester.triangleVertices);
+				bvh_bytes = bvh.MemoryBytes();
+			}, repeats);
+
+			std::vector<std::pair<int, int>> pairs;
+			double find_ms = MeasureMs([&]() { pairs = FindSelfIntersections(topology); }, repeats);
+
+			std::cout << "  triangles: " << topology.TrianglesCount() << ", intersecting pairs: " << pairs.size()
+				<< ", BVH " << bvh_bytes / (1024.0 * 1024.0) << " MB" << std::endl;
+			PrintResult("TriangleBVH build", build_ms, find_ms);
+			PrintResult("FindSelfIntersections", find_ms, find_ms);
+
+			if (topology.TrianglesCount() <= BRUTE_FORCE_TRIANGLES) {
+				std::vector<std::pair<int, int>> brute_force_pairs;
+				double brute_force_ms = MeasureMs([&]() {
+					brute_force_pairs.clear();
+					for (int a = 0; a < topology.TrianglesCount(); a++) {
+						for (int b = a + 1; b < topology.TrianglesCount(); b++) {
+							if (tester.Intersects(a, b)) {
+								brute_force_pairs.emplace_back(a, b);
+							}
+						}
+					}
+				}, 1);
+				std::cout << "  brute force: " << (brute_force_pairs == pairs ? "identical" : "MISMATCH") << std::endl;
+				PrintResult("brute force", brute_force_ms, find_ms);
+			}
+
+			unsigned int num_threads = stl_reader::stl_reader_impl::ResolveNumThreads(options.numThreads);
+			if (num_threads > 1) {
+				std::vector<std::pair<int, int>> parallel_pairs;
+				double parallel_ms = MeasureMs([&]() { parallel_pairs = FindSelfIntersections(topology, num_threads); }, repeats);
+				std::cout << "  " << num_threads << " threads: " << (parallel_pairs == pairs ? "identical" : "MISMATCH") << std::endl;
+				PrintResult("FindSelfIntersections (parallel)", parallel_ms, find_ms);
+			}
+		}
+
+		/*
+			比较std::fstream逐个输出的OBJ导出与ObjWriter缓冲导出（两种浮点格式）的吞吐
+		*/
+		inline void CompareObjWriter(const std::string& stl_file, const CheckerOptions& options, int repeats) {
+			std::cout << "[obj] " << stl_file << std::endl;
+
+			STLNonManifoldChecker checker(stl_file, options);
+
+			std::string temp_prefix = (std::filesystem::temp_directory_path() / ("stlnm_" + std::to_string(Log44::Utils::getPID()) + "_benchmark")).string();
+			std::string stream_path = temp_prefix + "_stream.obj";
+			std::string general_path = temp_prefix + "_general.obj";
+			std::string shortest_path = temp_prefix + "_shortest.obj";
+
+			double stream_ms = MeasureMs([&]() { checker.Export2OBJ_Stream(stream_path); }, repeats);
+			double general_ms = MeasureMs([&]() { checker.Export2OBJ(general_path, ObjFloatFormat::GENERAL_6); }, repeats);
+			double shortest_ms = MeasureMs([&]() { checker.Export2OBJ(shortest_path, ObjFloatFormat::SHORTEST); }, repeats);
+
+			auto read_file = [](const std::string& file_path) {
+				std::ifstream in(file_path, std::ios::binary);
+				return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+			};
+			std::string stream_output = read_file(stream_path);
+			bool same = stream_output == read_file(general_path);
+
+			double stream_mb = FileSizeMB(stream_path);
+			double shortest_mb = FileSizeMB(shortest_path);
+
+			std::cout << "  vertices: " << checker.verticesCount << ", triangles: " << checker.trianglesCount
+				<< ", " << stream_output.size() << " bytes" << (same ? ", identical" : ", MISMATCH") << std::endl;
+			PrintThroughput("Export2OBJ_Stream", stream_ms, stream_ms, stream_mb);
+			PrintThroughput("Export2OBJ", general_ms, stream_ms, stream_mb);
+			PrintThroughput("Export2OBJ (shortest)", shortest_ms, stream_ms, shortest_mb);
+
+			for (auto&& file_path : { stream_path, general_path, shortest_path }) {
+				std::error_code ec;
+				std::filesystem::remove(file_path, ec);
+			}
+		}
+
+#ifdef STL_READER_WITH_ZLIB
+		/*
+			比较gzip压缩文件的读取方式：先解压到临时文件再读取，与边解压边解析（ReadStlFile_GZIP）
+		*/
+		inline void CompareGzip(const std::string& stl_file, const CheckerOptions& options, int repeats) {
+			std::cout << "[gzip] " << stl_file << std::endl;
+
+			if (!stl_reader::StlFileIsGzip(stl_file.c_str())) {
+				std::cout << "  skipped: not a gzip compressed file" << std::endl;
+				return;
+			}
+
+			std::filesystem::path temp_path = std::filesystem::temp_directory_path() / ("stlnm_" + std::to_string(Log44::Utils::getPID()) + "_benchmark.stl");
+			StlArrays disk_arrays, stream_arrays;
+
+			double inflate_ms = MeasureMs([&]() {
+				stl_reader::GzipBlockReader reader;
+				reader.open(stl_file.c_str());
+				const char* block;
+				size_t block_size;
+				while (reader.next_block(block, block_size)) {
+				}
+			}, repeats);
+
+			double disk_ms = MeasureMs([&]() {
+				{
+					stl_reader::GzipBlockReader reader;
+					reader.open(stl_file.c_str());
+					std::ofstream f(temp_path, std::ios::binary | std::ios::trunc);
+					const char* block;
+					size_t block_size;
+					while (reader.next_block(block, block_size)) {
+						f.write(block, block_size);
+					}
+				}
+				stl_reader::ReadStlFile(temp_path.string().c_str(), disk_arrays.coords, disk_arrays.normals, disk_arrays.tris, disk_arrays.solids, options.numThreads, false);
+			}, repeats);
+
+			std::error_code ec;
+			std::filesystem::remove(temp_path, ec);
+
+			double stream_ms = MeasureMs([&]() {
+				stl_reader::ReadStlFile_GZIP(stl_file.c_str(), stream_arrays.coords, stream_arrays.normals, stream_arrays.tris, stream_arrays.solids, options.numThreads, false);
+			}, repeats);
+
+			std::cout << "  triangles: " << stream_arrays.tris.size() / 3 << (disk_arrays == stream_arrays ? ", identical" : ", MISMATCH") << std::endl;
+			PrintResult("inflate only", inflate_ms, disk_ms);
+			PrintResult("inflate to disk + ReadStlFile", disk_ms, disk_ms);
+			PrintResult("ReadStlFile_GZIP", stream_ms, disk_ms);
+		}
+#endif
+
+		/*
+			按名字运行基准测试，返回false表示名字未知
+		*/
+		inline bool Run(const std::string& name, const std::string& stl_file, const CheckerOptions& options, int repeats) {
+			if (name == "load") {
+				CompareLoad(stl_file, options, repeats);
+				return true;
+			}
+
+			if (name == "ascii") {
+				CompareAsciiParser(stl_file, options, repeats);
+				return true;
+			}
+
+			if (name == "dedup") {
+				CompareDedup(stl_file, options, repeats);
+				return true;
+			}
+
+			if (name == "kdtree") {
+				CompareKDTree(stl_file, options, repeats);
+				return true;
+			}
+
+			if (name == "weld") {
+				CompareWeld(stl_file, options, repeats);
+				return true;
+			}
+
+			if (name == "topology") {
+				CompareTopology(stl_file, options, repeats);
+				return true;
+			}
+
+			if (name == "intersect") {
+				CompareSelfIntersection(stl_file, options, repeats);
+				return true;
+			}
+
+			if (name == "obj") {
+				CompareObjWriter(stl_file, options, repeats);
+				return true;
+			}
+
+#ifdef STL_READER_WITH_ZLIB
+			if (name == "gzip") {
+				CompareGzip(stl_file, options, repeats);
+				return true;
+			}
+#endif
+
+			return false;
+		}
+
+	}
+
+} // namespace STLNonManifold
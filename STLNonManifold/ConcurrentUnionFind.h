@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <utility>
+
+namespace STLNonManifold {
+
+	/*
+		无锁并查集，多个线程可以同时Unite与Find
+
+		- 合并时总是把较大的根挂到较小的根下，每个集合的根始终为其中最小的下标，
+		  因此最终结果与合并的顺序、线程数无关
+		- 父节点只会变小，Find用CAS做路径减半，CAS失败说明已被其他线程改得更短，不需要重试
+	*/
+	class ConcurrentUnionFind {
+	public:
+		explicit ConcurrentUnionFind(int count) : parents(count) {
+			for (int i = 0; i < count; i++) {
+				parents[i].store(i, std::memory_order_relaxed);
+			}
+		}
+
+		int Size() const {
+			return static_cast<int>(parents.size());
+		}
+
+		/*
+			返回i所在集合的根（集合中最小的下标）
+		*/
+		int Find(int i) {
+			while (true) {
+				int parent = parents[i].load(std::memory_order_relaxed);
+				if (parent == i) {
+					return i;
+				}
+
+				int grandparent = parents[parent].load(std::memory_order_relaxed);
+				if (grandparent != parent) {
+					parents[i].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+				}
+				i = grandparent;
+			}
+		}
+
+		/*
+			合并a与b所在的集合
+		*/
+		void Unite(int a, int b) {
+			while (true) {
+				a = Find(a);
+				b = Find(b);
+				if (a == b) {
+					return;
+				}
+				if (a > b) {
+					std::swap(a, b);
+				}
+
+				// b仍是根时挂到a下，否则b已被其他线程合并，重新查找
+				int expected = b;
+				if (parents[b].compare_exchange_strong(expected, a, std::memory_order_relaxed)) {
+					return;
+				}
+			}
+		}
+
+	private:
+		std::vector<std::atomic<int>> parents;
+	};
+
+} // namespace STLNonManifold
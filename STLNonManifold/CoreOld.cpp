@@ -63,6 +63,8 @@ void Log44::Logger::log(Log44::LogLevel log_level, std::string&& file_name, std:
 		return;
 	}
 
+	std::lock_guard<std::mutex> lock(logMutex);
+
 	va_list args;
 	va_start(args, template_string);
 
@@ -9,6 +9,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
 
 #ifdef _WIN32
 #	include <windows.h>
@@ -124,6 +125,7 @@ namespace Log44 {
 		std::map<enum Log44::LogLevel, bool> logLevelControlMap;
 		ILogFormatter* logFormatter;
 		std::vector<ILogOutputTarget*> targetVec;
+		std::mutex logMutex; // log() may be called from several threads
 	};
 
 #ifdef _MSC_VER
@@ -0,0 +1,532 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <type_traits>
+
+// x86-64上SSE2总是可用，AVX在运行时检测
+#if defined(__x86_64__) || defined(_M_X64)
+#define FLAT_KDTREE_X86_64
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define FLAT_KDTREE_TARGET_AVX
+#else
+#define FLAT_KDTREE_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+/*
+	数组存储的KDTree，Match的语义与KDTree相同（各维差的绝对值都不超过ERROR_LIMITS的点）
+
+	- 所有节点按先序存放在一个vector中：左子节点紧跟在父节点之后，只记录右子节点的下标
+	- 点按叶子顺序复制到points中，每个叶子是points中一段不超过BUCKET_SIZE个点的区间
+	- 每个节点只保存包围盒的最小/最大坐标和点的区间，不再为每个点分配一个节点
+	- 树的形状只由点数决定，每个子树的节点数可以预先算出，因此上层的左右子树可以在不同线程中构造，
+	  结果与单线程构造完全相同
+	- 查询都是迭代遍历：ForEachMatch / Match(coord, indices)不分配内存地给出容差内的点在points中的下标，
+	  ForEachInRadius为半径查询，KNearest为k近邻查询
+	- DIM == 3且T_NUM为float时（编译期判断），ForEachMatch在x86-64上用SSE一次比较包围盒的三维，
+	  叶子中的点另存一份按维分开的坐标（pointsX / pointsY / pointsZ），整个叶子用AVX（8个点）或SSE（每次4个点）比较；
+	  simdLevel在构造时按CPU检测，不支持时退回标量代码，三者结果相同
+
+	CoordType 约束同KDTree：
+	- 重载了 [] 运算符
+	- 可默认构造
+	- 可复制
+*/
+
+template<typename CoordType, typename T_NUM, int DIM = 3>
+struct FlatKDTree {
+
+	// 匹配相同的容差
+	const T_NUM ERROR_LIMITS = 1e-6f;
+
+	// 叶子中点的最大个数
+	static constexpr int BUCKET_SIZE = 8;
+
+	// 点数不超过该值的子树不再拆分到新线程
+	static constexpr int PARALLEL_GRAIN_SIZE = 1 << 16;
+
+	// 是否使用SIMD路径
+	static constexpr bool SIMD_LAYOUT = DIM == 3 && std::is_same<T_NUM, float>::value;
+
+	// 包围盒每个坐标占用的分量数：三维float补齐到4个，正好是一个SSE寄存器
+	static constexpr int BOX_DIM = SIMD_LAYOUT ? 4 : DIM;
+
+	enum class SimdLevel {
+		SCALAR,
+		SSE,
+		AVX
+	};
+
+	struct alignas(16) FlatKDTreeNode {
+		T_NUM minRange[BOX_DIM]; // 补齐的分量为最小值/最大值，与查询点的0比较时总是有效
+		T_NUM maxRange[BOX_DIM];
+		int begin = 0; // 子树中的点在points中的区间[begin, end)
+		int end = 0;
+		int rightNode = -1; // 右子节点的下标，-1表示叶子节点；左子节点的下标为当前下标+1
+	};
+
+	FlatKDTree() : simdLevel(DetectSimdLevel()) {}
+
+	FlatKDTree(std::vector<CoordType> coords, unsigned int num_threads = 1) : simdLevel(DetectSimdLevel()) {
+		BuildTree(std::move(coords), num_threads);
+	}
+
+	/*
+		当前CPU支持的SIMD路径，非三维float的树为SCALAR
+	*/
+	static SimdLevel DetectSimdLevel() {
+#ifdef FLAT_KDTREE_X86_64
+		if (SIMD_LAYOUT) {
+			return CpuSupportsAvx() ? SimdLevel::AVX : SimdLevel::SSE;
+		}
+#endif
+		return SimdLevel::SCALAR;
+	}
+
+	/*
+		此处复制vector，点按叶子顺序重新排列
+		num_threads > 1时，点数大于grain_size的子树的左子树交给新线程构造，最多同时使用num_threads个线程
+	*/
+	void BuildTree(std::vector<CoordType> coords, unsigned int num_threads = 1, int grain_size = PARALLEL_GRAIN_SIZE) {
+		points = std::move(coords);
+		nodes.clear();
+
+		int points_count = static_cast<int>(points.size());
+		if (points_count == 0) {
+			return;
+		}
+
+		nodes.resize(CountNodes(points_count));
+		BuildNode(0, 0, points_count, std::max(1u, num_threads), std::max(grain_size, BUCKET_SIZE));
+
+		if constexpr (SIMD_LAYOUT) {
+			// 末尾多留一个叶子的空间，叶子总是可以整块读取
+			pointsX.assign(points_count + BUCKET_SIZE, 0.0f);
+			pointsY.assign(points_count + BUCKET_SIZE, 0.0f);
+			pointsZ.assign(points_count + BUCKET_SIZE, 0.0f);
+			for (int j = 0; j < points_count; j++) {
+				pointsX[j] = points[j][0];
+				pointsY[j] = points[j][1];
+				pointsZ[j] = points[j][2];
+			}
+		}
+	}
+
+	/*
+		points_count个点的子树的节点数：
+		点数不超过BUCKET_SIZE时为1个叶子，否则为1 + 左子树(points_count / 2个点) + 右子树
+	*/
+	static int CountNodes(int points_count) {
+		return CountNodesPair(points_count).first;
+	}
+
+	/*
+		对与coord_to_be_matched在容差内的每个点调用visitor(int)，参数为点在points中的下标
+		迭代遍历，不分配内存
+	*/
+	template<typename Visitor>
+	void ForEachMatch(const CoordType& coord_to_be_matched, Visitor&& visitor) const {
+		if (nodes.empty()) {
+			return;
+		}
+
+#ifdef FLAT_KDTREE_X86_64
+		if constexpr (SIMD_LAYOUT) {
+			if (simdLevel != SimdLevel::SCALAR) {
+				ForEachMatchSimd(coord_to_be_matched, visitor);
+				return;
+			}
+		}
+#endif
+
+		// 先序遍历的栈，深度不超过树高
+		int stack[MAX_DEPTH];
+		int stack_size = 0;
+		stack[stack_size++] = 0;
+
+		while (stack_size > 0) {
+			int node_index = stack[--stack_size];
+			const FlatKDTreeNode& now_node = nodes[node_index];
+
+			// 检查当前子树是否有效
+			bool is_subtree_valid = true;
+			for (int i = 0; i < DIM; i++) {
+				if (now_node.minRange[i] - ERROR_LIMITS > coord_to_be_matched[i] || now_node.maxRange[i] + ERROR_LIMITS < coord_to_be_matched[i]) {
+					is_subtree_valid = false;
+					break;
+				}
+			}
+			if (is_subtree_valid == false) {
+				continue;
+			}
+
+			if (now_node.rightNode < 0) {
+				for (int j = now_node.begin; j < now_node.end; j++) {
+					if (IsSame(points[j], coord_to_be_matched)) {
+						visitor(j);
+					}
+				}
+				continue;
+			}
+
+			// 右子树先入栈，先检查左子树
+			stack[stack_size++] = now_node.rightNode;
+			stack[stack_size++] = node_index + 1;
+		}
+	}
+
+	/*
+		匹配相等的坐标点，下标（points中的下标）写入可复用的indices（先清空）
+	*/
+	void Match(const CoordType& coord_to_be_matched, std::vector<int>& indices) const {
+		indices.clear();
+		ForEachMatch(coord_to_be_matched, [&](int j) {
+			indices.push_back(j);
+		});
+	}
+
+	/*
+		匹配相等的坐标点，并返回所有相同的点的vector
+	*/
+	std::vector<CoordType> Match(const CoordType& coord_to_be_matched) const {
+		std::vector<CoordType> result_coords;
+		ForEachMatch(coord_to_be_matched, [&](int j) {
+			result_coords.emplace_back(points[j]);
+		});
+		return result_coords;
+	}
+
+	/*
+		对与center的欧氏距离不超过radius的每个点调用visitor(int, double)，参数为点在points中的下标与距离的平方
+	*/
+	template<typename Visitor>
+	void ForEachInRadius(const CoordType& center, double radius, Visitor&& visitor) const {
+		if (nodes.empty() || radius < 0.0) {
+			return;
+		}
+
+		double radius_sq = radius * radius;
+
+		int stack[MAX_DEPTH];
+		int stack_size = 0;
+		stack[stack_size++] = 0;
+
+		while (stack_size > 0) {
+			int node_index = stack[--stack_size];
+			const FlatKDTreeNode& now_node = nodes[node_index];
+
+			if (BoxDistanceSq(now_node, center) > radius_sq) {
+				continue;
+			}
+
+			if (now_node.rightNode < 0) {
+				for (int j = now_node.begin; j < now_node.end; j++) {
+					double dist_sq = DistanceSq(points[j], center);
+					if (dist_sq <= radius_sq) {
+						visitor(j, dist_sq);
+					}
+				}
+				continue;
+			}
+
+			stack[stack_size++] = now_node.rightNode;
+			stack[stack_size++] = node_index + 1;
+		}
+	}
+
+	/*
+		k近邻：与center最近的k个点（不足k个时为全部点），按距离从近到远写入可复用的result（先清空），
+		每项为（距离的平方，points中的下标），距离相同时下标小的在前
+	*/
+	void KNearest(const CoordType& center, int k, std::vector<std::pair<double, int>>& result) const {
+		result.clear();
+		if (nodes.empty() || k <= 0) {
+			return;
+		}
+
+		// result作为最大堆，堆顶为当前第k近的点
+		auto worst_sq = [&]() {
+			return static_cast<int>(result.size()) < k ? std::numeric_limits<double>::infinity() : result.front().first;
+		};
+
+		// 栈中同时保存节点包围盒到center的距离，出栈时若已比第k近的点远则跳过
+		std::pair<double, int> stack[MAX_DEPTH];
+		int stack_size = 0;
+		stack[stack_size++] = std::make_pair(BoxDistanceSq(nodes[0], center), 0);
+
+		while (stack_size > 0) {
+			std::pair<double, int> item = stack[--stack_size];
+			if (item.first > worst_sq()) {
+				continue;
+			}
+
+			const FlatKDTreeNode& now_node = nodes[item.second];
+			if (now_node.rightNode < 0) {
+				for (int j = now_node.begin; j < now_node.end; j++) {
+					std::pair<double, int> candidate(DistanceSq(points[j], center), j);
+					if (static_cast<int>(result.size()) < k) {
+						result.push_back(candidate);
+						std::push_heap(result.begin(), result.end());
+					}
+					else if (candidate < result.front()) {
+						std::pop_heap(result.begin(), result.end());
+						result.back() = candidate;
+						std::push_heap(result.begin(), result.end());
+					}
+				}
+				continue;
+			}
+
+			// 较近的子节点后入栈，先访问
+			int left_index = item.second + 1;
+			int right_index = now_node.rightNode;
+			double left_sq = BoxDistanceSq(nodes[left_index], center);
+			double right_sq = BoxDistanceSq(nodes[right_index], center);
+			if (left_sq <= right_sq) {
+				stack[stack_size++] = std::make_pair(right_sq, right_index);
+				stack[stack_size++] = std::make_pair(left_sq, left_index);
+			}
+			else {
+				stack[stack_size++] = std::make_pair(left_sq, left_index);
+				stack[stack_size++] = std::make_pair(right_sq, right_index);
+			}
+		}
+
+		std::sort_heap(result.begin(), result.end());
+	}
+
+	/*
+		节点与点占用的内存（字节）
+	*/
+	size_t MemoryBytes() const {
+		return nodes.capacity() * sizeof(FlatKDTreeNode) + points.capacity() * sizeof(CoordType)
+			+ (pointsX.capacity() + pointsY.capacity() + pointsZ.capacity()) * sizeof(float);
+	}
+
+	std::vector<FlatKDTreeNode> nodes;
+	std::vector<CoordType> points;
+
+	// 按维分开的点坐标，只在SIMD_LAYOUT时使用
+	std::vector<float> pointsX;
+	std::vector<float> pointsY;
+	std::vector<float> pointsZ;
+
+	// ForEachMatch使用的SIMD路径，可以改为更低的级别（如用于比较）
+	SimdLevel simdLevel = SimdLevel::SCALAR;
+
+private:
+	// 每层至少把点数减半，int下标的树高不超过32
+	static constexpr int MAX_DEPTH = 64;
+
+	static double DistanceSq(const CoordType& a, const CoordType& b) {
+		double dist_sq = 0.0;
+		for (int i = 0; i < DIM; i++) {
+			double d = static_cast<double>(a[i]) - static_cast<double>(b[i]);
+			dist_sq += d * d;
+		}
+		return dist_sq;
+	}
+
+	/*
+		点到节点包围盒的距离的平方，点在盒内时为0
+	*/
+	static double BoxDistanceSq(const FlatKDTreeNode& node, const CoordType& coord) {
+		double dist_sq = 0.0;
+		for (int i = 0; i < DIM; i++) {
+			double d = 0.0;
+			if (coord[i] < node.minRange[i]) {
+				d = static_cast<double>(node.minRange[i]) - static_cast<double>(coord[i]);
+			}
+			else if (coord[i] > node.maxRange[i]) {
+				d = static_cast<double>(coord[i]) - static_cast<double>(node.maxRange[i]);
+			}
+			dist_sq += d * d;
+		}
+		return dist_sq;
+	}
+
+#ifdef FLAT_KDTREE_X86_64
+	static bool CpuSupportsAvx() {
+#if defined(_MSC_VER) && !defined(__clang__)
+		// CPUID.1:ECX的OSXSAVE(27)与AVX(28)，且操作系统保存了YMM寄存器
+		int info[4];
+		__cpuid(info, 1);
+		if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) {
+			return false;
+		}
+		return (_xgetbv(0) & 0x6) == 0x6;
+#else
+		return __builtin_cpu_supports("avx");
+#endif
+	}
+
+	/*
+		SSE比较叶子中从begin开始的count个点，返回在容差内的点的位掩码
+	*/
+	unsigned int LeafMatchMaskSse(int begin, int count, __m128 qx, __m128 qy, __m128 qz, __m128 eps) const {
+		const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+		unsigned int mask = 0;
+		for (int k = 0; k < count; k += 4) {
+			__m128 dx = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(&pointsX[begin + k]), qx), abs_mask);
+			__m128 dy = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(&pointsY[begin + k]), qy), abs_mask);
+			__m128 dz = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(&pointsZ[begin + k]), qz), abs_mask);
+			__m128 out = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(dx, eps), _mm_cmpgt_ps(dy, eps)), _mm_cmpgt_ps(dz, eps));
+			mask |= static_cast<unsigned int>(~_mm_movemask_ps(out) & 0xF) << k;
+		}
+		return mask & ((1u << count) - 1);
+	}
+
+	/*
+		AVX一次比较叶子中的（最多8个）点，返回在容差内的点的位掩码
+	*/
+	FLAT_KDTREE_TARGET_AVX unsigned int LeafMatchMaskAvx(int begin, int count, const float* query, float error_limits) const {
+		const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+		__m256 eps = _mm256_set1_ps(error_limits);
+		__m256 dx = _mm256_and_ps(_mm256_sub_ps(_mm256_loadu_ps(&pointsX[begin]), _mm256_set1_ps(query[0])), abs_mask);
+		__m256 dy = _mm256_and_ps(_mm256_sub_ps(_mm256_loadu_ps(&pointsY[begin]), _mm256_set1_ps(query[1])), abs_mask);
+		__m256 dz = _mm256_and_ps(_mm256_sub_ps(_mm256_loadu_ps(&pointsZ[begin]), _mm256_set1_ps(query[2])), abs_mask);
+		__m256 out = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(dx, eps, _CMP_GT_OQ), _mm256_cmp_ps(dy, eps, _CMP_GT_OQ)), _mm256_cmp_ps(dz, eps, _CMP_GT_OQ));
+		return static_cast<unsigned int>(~_mm256_movemask_ps(out)) & ((1u << count) - 1);
+	}
+
+	/*
+		ForEachMatch的SIMD路径：包围盒的三维用一次SSE比较，叶子按simdLevel用AVX或SSE比较
+	*/
+	template<typename Visitor>
+	void ForEachMatchSimd(const CoordType& coord_to_be_matched, Visitor&& visitor) const {
+		alignas(16) float query[4] = { coord_to_be_matched[0], coord_to_be_matched[1], coord_to_be_matched[2], 0.0f };
+		__m128 query_v = _mm_load_ps(query);
+		__m128 eps = _mm_set1_ps(ERROR_LIMITS);
+		__m128 qx = _mm_set1_ps(query[0]);
+		__m128 qy = _mm_set1_ps(query[1]);
+		__m128 qz = _mm_set1_ps(query[2]);
+		bool use_avx = simdLevel == SimdLevel::AVX;
+
+		int stack[MAX_DEPTH];
+		int stack_size = 0;
+		stack[stack_size++] = 0;
+
+		while (stack_size > 0) {
+			int node_index = stack[--stack_size];
+			const FlatKDTreeNode& now_node = nodes[node_index];
+
+			// 与标量代码相同：minRange - ERROR_LIMITS > coord 或 maxRange + ERROR_LIMITS < coord 时剪枝
+			__m128 lo = _mm_sub_ps(_mm_load_ps(now_node.minRange), eps);
+			__m128 hi = _mm_add_ps(_mm_load_ps(now_node.maxRange), eps);
+			if (_mm_movemask_ps(_mm_or_ps(_mm_cmpgt_ps(lo, query_v), _mm_cmplt_ps(hi, query_v))) != 0) {
+				continue;
+			}
+
+			if (now_node.rightNode < 0) {
+				int count = now_node.end - now_node.begin;
+				unsigned int mask = use_avx ? LeafMatchMaskAvx(now_node.begin, count, query, ERROR_LIMITS) : LeafMatchMaskSse(now_node.begin, count, qx, qy, qz, eps);
+				for (int k = 0; mask != 0; k++, mask >>= 1) {
+					if (mask & 1) {
+						visitor(now_node.begin + k);
+					}
+				}
+				continue;
+			}
+
+			stack[stack_size++] = now_node.rightNode;
+			stack[stack_size++] = node_index + 1;
+		}
+	}
+#endif
+
+	bool IsSame(const CoordType& a, const CoordType& b) const {
+		for (int i = 0; i < DIM; i++) {
+			if (std::abs(a[i] - b[i]) > ERROR_LIMITS) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/*
+		返回k个点与k + 1个点的子树的节点数（同一层的子树点数只有两种，逐层减半计算）
+	*/
+	static std::pair<int, int> CountNodesPair(int k) {
+		if (k + 1 <= BUCKET_SIZE) {
+			return std::make_pair(1, 1);
+		}
+
+		// half为(k / 2, k / 2 + 1)个点的节点数
+		std::pair<int, int> half = CountNodesPair(k / 2);
+		if (k % 2 == 0) {
+			return std::make_pair(k <= BUCKET_SIZE ? 1 : 1 + 2 * half.first, 1 + half.first + half.second);
+		}
+		return std::make_pair(k <= BUCKET_SIZE ? 1 : 1 + half.first + half.second, 1 + 2 * half.second);
+	}
+
+	/*
+		在nodes[node_index]构造points[l, r)的子树，子树的节点依次存放在node_index之后
+		沿包围盒最长的一维在中位数处划分
+		num_threads为该子树可用的线程数
+	*/
+	void BuildNode(int node_index, int l, int r, unsigned int num_threads, int grain_size) {
+		FlatKDTreeNode node;
+		node.begin = l;
+		node.end = r;
+		for (int i = 0; i < DIM; i++) {
+			node.minRange[i] = std::numeric_limits<T_NUM>::max();
+			node.maxRange[i] = std::numeric_limits<T_NUM>::lowest();
+		}
+		for (int i = DIM; i < BOX_DIM; i++) {
+			node.minRange[i] = std::numeric_limits<T_NUM>::lowest();
+			node.maxRange[i] = std::numeric_limits<T_NUM>::max();
+		}
+		for (int j = l; j < r; j++) {
+			for (int i = 0; i < DIM; i++) {
+				node.minRange[i] = std::min(node.minRange[i], points[j][i]);
+				node.maxRange[i] = std::max(node.maxRange[i], points[j][i]);
+			}
+		}
+
+		if (r - l > BUCKET_SIZE) {
+			int split_dim = 0;
+			for (int i = 1; i < DIM; i++) {
+				if (node.maxRange[i] - node.minRange[i] > node.maxRange[split_dim] - node.minRange[split_dim]) {
+					split_dim = i;
+				}
+			}
+
+			int mid = (l + r) >> 1;
+
+			// 利用nth_element划分
+			std::nth_element(
+				points.begin() + l,
+				points.begin() + mid,
+				points.begin() + r,
+				[&](const CoordType& a, const CoordType& b) {
+					return a[split_dim] < b[split_dim];
+				}
+			);
+
+			node.rightNode = node_index + 1 + CountNodes(mid - l);
+
+			if (num_threads > 1 && r - l > grain_size) {
+				// 左子树交给新线程，两边按线程数平分
+				unsigned int left_threads = num_threads / 2;
+				std::thread left_thread([&]() {
+					BuildNode(node_index + 1, l, mid, left_threads, grain_size);
+				});
+				BuildNode(node.rightNode, mid, r, num_threads - left_threads, grain_size);
+				left_thread.join();
+			}
+			else {
+				BuildNode(node_index + 1, l, mid, 1, grain_size);
+				BuildNode(node.rightNode, mid, r, 1, grain_size);
+			}
+		}
+
+		nodes[node_index] = node;
+	}
+};
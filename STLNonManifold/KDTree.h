@@ -13,17 +13,17 @@
 #include <limits>
 
 /*
-	CoordType Լ
-	-  [] 
-	-  == 
-	- ĬϹ
-	- ɸ
+	CoordType 约束：
+	- 重载了 [] 运算符
+	- 重载了 == 运算符
+	- 可默认构造
+	- 可复制
 */
 
 template<typename CoordType, typename T_NUM, int DIM = 3>
 struct KDTree {
 
-	// ƥͬݲ
+	// 匹配相同的容差
 	const T_NUM ERROR_LIMITS = 1e-6f;
 
 	struct KDTreeNode {
@@ -42,18 +42,18 @@ struct KDTree {
 		BuildTree(std::move(coords));
 	}
 
-	// ˴븴vector򽫵ԭvector
+	// 此处必须复制vector，否则将导致原vector被打乱
 	void BuildTree(std::vector<CoordType> coords) {
 
-		// Ҷӽڵ
+		// 叶子节点
 		auto construct_leaf_node = [&](const CoordType& coord, int now_dim) ->std::unique_ptr<KDTreeNode> {
 			std::unique_ptr<KDTreeNode> node = std::make_unique<KDTreeNode>();
 			
 			node->isLeaf = true;
 			node->splitDim = now_dim;
-			node->leafPoint = coord; // 
+			node->leafPoint = coord; // 复制
 
-			// rangePoints
+			// 更新rangePoints
 			for (int i = 0; i < DIM; i++) {
 				node->minRangePoint[i] = coord[i];
 				node->maxRangePoint[i] = coord[i];
@@ -62,20 +62,20 @@ struct KDTree {
 			return std::move(node);
 		};
 
-		// Ҷӽڵ
+		// 非叶子节点
 		auto construct_middle_node = [&](std::unique_ptr<KDTreeNode> leftNode, std::unique_ptr<KDTreeNode> rightNode, int now_dim) ->std::unique_ptr<KDTreeNode> {
 			std::unique_ptr<KDTreeNode> node = std::make_unique<KDTreeNode>();
 
 			node->isLeaf = false;
 			node->splitDim = now_dim;
 
-			// rangePointsĬСֵֵ
+			// rangePoints设置默认最小值和最大值
 			for (int i = 0; i < DIM; i++) {
 				node->minRangePoint[i] = std::numeric_limits<T_NUM>::max();
 				node->maxRangePoint[i] = std::numeric_limits<T_NUM>::min();
 			}
 
-			// ҽڵָ룬ͬʱrangePoints
+			// 更新左右节点指针，同时更新rangePoints
 			if (leftNode) {
 				for (int i = 0; i < DIM; i++) {
 					node->minRangePoint[i] = std::min(node->minRangePoint[i], leftNode->minRangePoint[i]);
@@ -97,7 +97,7 @@ struct KDTree {
 			return std::move(node);
 		};
 
-		// ݹ鹹
+		// 递归构造
 		std::function<std::unique_ptr<KDTreeNode>(std::vector<CoordType>&, int, int, int)> recursive_construct = [&](std::vector<CoordType>& coords, int now_dim, int l, int r) -> std::unique_ptr<KDTreeNode> {
 			if (l == r) {
 				return std::move(construct_leaf_node(coords[l], now_dim));
@@ -109,7 +109,7 @@ struct KDTree {
 
 			int mid = (l + r) >> 1;
 
-			// nth_element
+			// 利用nth_element划分
 			std::nth_element(
 				coords.begin() + l,
 				coords.begin() + mid,
@@ -129,14 +129,14 @@ struct KDTree {
 	}
 
 	/*
-		ƥȵ㣬ͬĵvector
+		匹配相等的坐标点，并返回所有相同的点的vector
 	*/
 	std::vector<CoordType> Match(const CoordType& coord_to_be_matched) {
 		
 		std::vector<CoordType> result_coords;
 
 		/*
-			֦false򷵻true
+			若满足剪枝条件，返回false，否则返回true
 		*/
 		auto is_subtree_valid = [&](KDTreeNode* now_node) -> bool {
 
@@ -154,7 +154,7 @@ struct KDTree {
 		};
 
 		/*
-			ҶӽڵеĵʹƥݲΧ򷵻true
+			若叶子节点中的点和待匹配点在容差范围内则返回true
 		*/
 		auto is_leaf_valid = [&](KDTreeNode* now_leaf_node) -> bool {
 
@@ -167,7 +167,7 @@ struct KDTree {
 			}
 
 			for (int i = 0; i < DIM; i++) {
-				if (abs(now_leaf_node->leafPoint[i] - coord_to_be_matched[i]) > ERROR_LIMITS) {
+				if (std::abs(now_leaf_node->leafPoint[i] - coord_to_be_matched[i]) > ERROR_LIMITS) {
 					return false;
 				}
 			}
@@ -185,12 +185,12 @@ struct KDTree {
 				return;
 			}
 
-			// 鵱ǰǷЧ
+			// 检查当前子树是否有效
 			if (is_subtree_valid(now_root) == false) {
 				return;
 			}
 
-			// 
+			// 检查左右子树
 			if (now_root->leftNode) {
 				recursive_match(now_root->leftNode.get());
 			}
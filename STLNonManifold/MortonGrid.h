@@ -0,0 +1,362 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "./stl_reader/stl_reader.h"
+
+/*
+	按Morton码（Z曲线）排序的均匀网格，用于在容差内匹配坐标点，Match的语义与KDTree相同（各维差的绝对值都不超过ERROR_LIMITS的点）
+
+	- 坐标相对包围盒量化为格子坐标，每一维21位，交叉得到63位的Morton码；格子边长为CELL_SCALE倍ERROR_LIMITS，
+	  包围盒过大时放大格子边长，使格子坐标不超过21位
+	- 点按（Morton码, 原顺序）用并行LSD基数排序，同一格子的点相邻，格子按Morton码排列，空间上相近的格子在数组中也相近
+	- 不需要哈希表：格子编号即排序后不同Morton码的序号，邻近格子用二分查找
+	- 查询范围（放宽到2倍ERROR_LIMITS）每一维最多跨两个格子，与SpatialHashGrid相同
+
+	CoordType 约束同KDTree：
+	- 重载了 [] 运算符
+	- 可默认构造
+	- 可复制
+*/
+
+template<typename CoordType, typename T_NUM>
+struct MortonGrid {
+
+	// 匹配相同的容差
+	const T_NUM ERROR_LIMITS = 1e-6f;
+
+	// 格子边长与容差之比（包围盒不大时）
+	static constexpr double CELL_SCALE = 64.0;
+
+	// 每一维格子坐标的位数
+	static constexpr int AXIS_BITS = 21;
+	static constexpr long long MAX_CELL_INDEX = (1ll << AXIS_BITS) - 1;
+
+	struct MortonKey {
+		uint64_t code;
+		int index; // 在BuildGrid的coords中的下标
+	};
+
+	MortonGrid() {}
+
+	MortonGrid(const std::vector<CoordType>& coords, unsigned int num_threads = 1) {
+		BuildGrid(coords, num_threads);
+	}
+
+	/*
+		量化、计算Morton码并排序，num_threads为0时使用全部硬件线程
+	*/
+	void BuildGrid(const std::vector<CoordType>& coords, unsigned int num_threads = 1) {
+		cellCodes.clear();
+		cellBegin.clear();
+		points.clear();
+		if (coords.empty()) {
+			return;
+		}
+
+		num_threads = stl_reader::stl_reader_impl::ResolveNumThreads(num_threads);
+		size_t n = coords.size();
+		size_t num_ranges = std::max<size_t>(1, std::min<size_t>(num_threads, n / MIN_RANGE_SIZE));
+		auto range_begin = [&](size_t r) { return n * r / num_ranges; };
+
+		// 包围盒，原点向外留出查询范围，使查询的格子坐标不为负
+		double min_coord[3], max_coord[3];
+		for (int i = 0; i < 3; i++) {
+			min_coord[i] = max_coord[i] = static_cast<double>(coords[0][i]);
+		}
+		for (size_t j = 1; j < n; j++) {
+			for (int i = 0; i < 3; i++) {
+				min_coord[i] = std::min(min_coord[i], static_cast<double>(coords[j][i]));
+				max_coord[i] = std::max(max_coord[i], static_cast<double>(coords[j][i]));
+			}
+		}
+
+		double margin = 4.0 * ERROR_LIMITS;
+		double extent = 0.0;
+		for (int i = 0; i < 3; i++) {
+			origin[i] = min_coord[i] - margin;
+			extent = std::max(extent, max_coord[i] - min_coord[i] + 2.0 * margin);
+		}
+		cellSize = std::max(CELL_SCALE * static_cast<double>(ERROR_LIMITS), extent / static_cast<double>(MAX_CELL_INDEX));
+		inverseCellSize = 1.0 / cellSize;
+
+		// 量化并交叉位，每个线程处理一段
+		std::vector<MortonKey> keys(n);
+		stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t r) {
+			for (size_t j = range_begin(r); j < range_begin(r + 1); j++) {
+				keys[j].code = Encode(GetCellIndex(coords[j][0], 0), GetCellIndex(coords[j][1], 1), GetCellIndex(coords[j][2], 2));
+				keys[j].index = static_cast<int>(j);
+			}
+		});
+
+		SortKeys(keys, num_ranges);
+
+		// 相同Morton码的一段为一个格子
+		for (size_t k = 0; k < n; k++) {
+			if (k == 0 || keys[k].code != keys[k - 1].code) {
+				cellCodes.push_back(keys[k].code);
+				cellBegin.push_back(static_cast<int>(k));
+			}
+		}
+		cellBegin.push_back(static_cast<int>(n));
+
+		points.resize(n);
+		stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t r) {
+			for (size_t k = range_begin(r); k < range_begin(r + 1); k++) {
+				points[k] = coords[keys[k].index];
+			}
+		});
+	}
+
+	/*
+		对容差范围内的每个点调用visitor(const CoordType&)
+	*/
+	template<typename Visitor>
+	void ForEachMatch(const CoordType& coord_to_be_matched, Visitor&& visitor) const {
+		if (points.empty()) {
+			return;
+		}
+
+		long long lo[3], hi[3];
+		for (int i = 0; i < 3; i++) {
+			lo[i] = GetCellIndex(static_cast<double>(coord_to_be_matched[i]) - 2.0 * ERROR_LIMITS, i);
+			hi[i] = GetCellIndex(static_cast<double>(coord_to_be_matched[i]) + 2.0 * ERROR_LIMITS, i);
+		}
+
+		for (long long x = lo[0]; x <= hi[0]; x++) {
+			for (long long y = lo[1]; y <= hi[1]; y++) {
+				for (long long z = lo[2]; z <= hi[2]; z++) {
+					int cell = FindCell(Encode(x, y, z));
+					if (cell < 0) {
+						continue;
+					}
+					for (int j = cellBegin[cell]; j < cellBegin[cell + 1]; j++) {
+						if (IsSame(points[j], coord_to_be_matched)) {
+							visitor(points[j]);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	/*
+		对每一对容差内的点调用visitor(const CoordType&, const CoordType&)，每对只调用一次
+	*/
+	template<typename Visitor>
+	void ForEachMatchedPair(Visitor&& visitor) const {
+		ForEachMatchedPair(visitor, 0, CellsCount());
+	}
+
+	/*
+		只遍历格子[cell_begin, cell_end)中的点，每对点只在编号较大的格子（或同一格子中较后的点）处调用一次，
+		因此多个线程可以各自处理不相交的格子区间
+	*/
+	template<typename Visitor>
+	void ForEachMatchedPair(Visitor&& visitor, int cell_begin, int cell_end) const {
+		for (int cell = cell_begin; cell < cell_end; cell++) {
+			for (int j = cellBegin[cell]; j < cellBegin[cell + 1]; j++) {
+				const CoordType& coord = points[j];
+
+				long long lo[3], hi[3];
+				bool inside_cell = true;
+				for (int i = 0; i < 3; i++) {
+					long long own = GetCellIndex(static_cast<double>(coord[i]), i);
+					lo[i] = GetCellIndex(static_cast<double>(coord[i]) - 2.0 * ERROR_LIMITS, i);
+					hi[i] = GetCellIndex(static_cast<double>(coord[i]) + 2.0 * ERROR_LIMITS, i);
+					if (lo[i] != own || hi[i] != own) {
+						inside_cell = false;
+					}
+				}
+
+				// 同一格子中只与之前的点配对
+				for (int k = cellBegin[cell]; k < j; k++) {
+					if (IsSame(points[k], coord)) {
+						visitor(coord, points[k]);
+					}
+				}
+
+				if (inside_cell) {
+					continue;
+				}
+
+				// 不同格子之间只与编号更小（即Morton码更小）的格子中的点配对
+				for (long long x = lo[0]; x <= hi[0]; x++) {
+					for (long long y = lo[1]; y <= hi[1]; y++) {
+						for (long long z = lo[2]; z <= hi[2]; z++) {
+							uint64_t code = Encode(x, y, z);
+							if (code >= cellCodes[cell]) {
+								continue;
+							}
+							int other_cell = FindCell(code);
+							if (other_cell < 0) {
+								continue;
+							}
+							for (int k = cellBegin[other_cell]; k < cellBegin[other_cell + 1]; k++) {
+								if (IsSame(points[k], coord)) {
+									visitor(coord, points[k]);
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	/*
+		匹配相等的坐标点，并返回所有相同的点的vector
+	*/
+	std::vector<CoordType> Match(const CoordType& coord_to_be_matched) const {
+		std::vector<CoordType> result_coords;
+		ForEachMatch(coord_to_be_matched, [&](const CoordType& coord) {
+			result_coords.emplace_back(coord);
+		});
+		return result_coords;
+	}
+
+	int CellsCount() const {
+		return static_cast<int>(cellCodes.size());
+	}
+
+	/*
+		格子与点占用的内存（字节）
+	*/
+	size_t MemoryBytes() const {
+		return cellCodes.capacity() * sizeof(uint64_t) + cellBegin.capacity() * sizeof(int) + points.capacity() * sizeof(CoordType);
+	}
+
+	/*
+		把21位整数的各位分散到每3位的最低位：无分支的移位与掩码，对连续的点可被编译器向量化
+	*/
+	static uint64_t SpreadBits(uint64_t v) {
+		v &= 0x1FFFFFull;
+		v = (v | (v << 32)) & 0x001F00000000FFFFull;
+		v = (v | (v << 16)) & 0x001F0000FF0000FFull;
+		v = (v | (v << 8)) & 0x100F00F00F00F00Full;
+		v = (v | (v << 4)) & 0x10C30C30C30C30C3ull;
+		v = (v | (v << 2)) & 0x1249249249249249ull;
+		return v;
+	}
+
+	static uint64_t Encode(long long x, long long y, long long z) {
+		return SpreadBits(static_cast<uint64_t>(x)) | (SpreadBits(static_cast<uint64_t>(y)) << 1) | (SpreadBits(static_cast<uint64_t>(z)) << 2);
+	}
+
+	double origin[3] = { 0.0, 0.0, 0.0 };
+	double cellSize = 0.0;
+	double inverseCellSize = 0.0;
+	std::vector<uint64_t> cellCodes; // 格子编号 -> Morton码，递增
+	std::vector<int> cellBegin; // 格子c中的点为points[cellBegin[c], cellBegin[c + 1])
+	std::vector<CoordType> points; // 按Morton码排列，同一格子内按原顺序
+
+private:
+	// 每个线程至少处理的点数
+	static constexpr size_t MIN_RANGE_SIZE = 1 << 16;
+
+	// 点数少于该值时用比较排序
+	static constexpr size_t MIN_RADIX_SORT_SIZE = 1 << 10;
+
+	/*
+		所有格子坐标都由这里计算，同一坐标得到的格子一定相同
+		原点以下的值截断后不大于0，与先取floor再限制到0的结果相同，因此不需要floor
+	*/
+	long long GetCellIndex(double value, int axis) const {
+		long long index = static_cast<long long>((value - origin[axis]) * inverseCellSize);
+		return std::min(std::max(index, 0ll), MAX_CELL_INDEX);
+	}
+
+	/*
+		按Morton码稳定排序（相同码保持原顺序），与stl_reader的RadixSortCoords相同的做法：
+		16位一个数位的LSD基数排序，每一遍分为num_ranges段并行计数与分发，所有点数位相同的一遍跳过
+	*/
+	static void SortKeys(std::vector<MortonKey>& keys, size_t num_ranges) {
+		const int DIGIT_BITS = 16;
+		const size_t NUM_BUCKETS = size_t(1) << DIGIT_BITS;
+
+		size_t n = keys.size();
+		if (n < MIN_RADIX_SORT_SIZE) {
+			std::sort(keys.begin(), keys.end(), [](const MortonKey& a, const MortonKey& b) {
+				return a.code < b.code || (a.code == b.code && a.index < b.index);
+			});
+			return;
+		}
+
+		std::vector<MortonKey> buffer(n);
+		std::vector<size_t> counts(num_ranges * NUM_BUCKETS);
+		MortonKey* src = keys.data();
+		MortonKey* dst = buffer.data();
+		auto range_begin = [&](size_t r) { return n * r / num_ranges; };
+
+		for (int shift = 0; shift < 3 * AXIS_BITS; shift += DIGIT_BITS) {
+			auto digit = [&](const MortonKey& key) {
+				return static_cast<size_t>((key.code >> shift) & (NUM_BUCKETS - 1));
+			};
+
+			stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t r) {
+				size_t* range_counts = &counts[r * NUM_BUCKETS];
+				std::fill(range_counts, range_counts + NUM_BUCKETS, size_t(0));
+				for (size_t i = range_begin(r); i < range_begin(r + 1); i++) {
+					range_counts[digit(src[i])]++;
+				}
+			});
+
+			bool trivial = false;
+			for (size_t b = 0; b < NUM_BUCKETS; b++) {
+				size_t total = 0;
+				for (size_t r = 0; r < num_ranges; r++) {
+					total += counts[r * NUM_BUCKETS + b];
+				}
+				if (total != 0) {
+					trivial = (total == n);
+					break;
+				}
+			}
+			if (trivial) {
+				continue;
+			}
+
+			size_t offset = 0;
+			for (size_t b = 0; b < NUM_BUCKETS; b++) {
+				for (size_t r = 0; r < num_ranges; r++) {
+					size_t count = counts[r * NUM_BUCKETS + b];
+					counts[r * NUM_BUCKETS + b] = offset;
+					offset += count;
+				}
+			}
+
+			stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t r) {
+				size_t* range_offsets = &counts[r * NUM_BUCKETS];
+				for (size_t i = range_begin(r); i < range_begin(r + 1); i++) {
+					dst[range_offsets[digit(src[i])]++] = src[i];
+				}
+			});
+
+			std::swap(src, dst);
+		}
+
+		if (src != keys.data()) {
+			keys.swap(buffer);
+		}
+	}
+
+	int FindCell(uint64_t code) const {
+		auto it = std::lower_bound(cellCodes.begin(), cellCodes.end(), code);
+		if (it == cellCodes.end() || *it != code) {
+			return -1;
+		}
+		return static_cast<int>(it - cellCodes.begin());
+	}
+
+	bool IsSame(const CoordType& a, const CoordType& b) const {
+		for (int i = 0; i < 3; i++) {
+			if (std::abs(a[i] - b[i]) > ERROR_LIMITS) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
@@ -0,0 +1,142 @@
+#pragma once
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+namespace STLNonManifold {
+
+	/*
+		OBJ中浮点数的格式
+		- GENERAL_6：与std::ostream的默认格式相同（%g，6位有效数字），输出与Export2OBJ_Stream逐字节相同
+		- SHORTEST：能无损读回原值的最短表示
+	*/
+	enum class ObjFloatFormat {
+		GENERAL_6,
+		SHORTEST
+	};
+
+	/*
+		缓冲OBJ写出：数字用std::to_chars格式化到可复用的大缓冲区，缓冲区满时整块写出
+		文件以文本模式打开，与std::fstream的写法一致（Windows下换行同样转换为\r\n）
+	*/
+	class ObjWriter {
+	public:
+		// 缓冲区超过该大小时写出
+		static const size_t BUFFER_SIZE = 1 << 20;
+
+		// 单个数字最多占用的字节数
+		static const size_t MAX_ITEM_SIZE = 64;
+
+		ObjWriter(const std::string& file_path, ObjFloatFormat float_format = ObjFloatFormat::GENERAL_6) : floatFormat(float_format) {
+			f.open(file_path, std::ios::out | std::ios::trunc);
+			if (!f.is_open()) {
+				throw std::runtime_error("Open output_obj_file_path failed.");
+			}
+			buffer.resize(BUFFER_SIZE);
+		}
+
+		~ObjWriter() {
+			// 析构时不抛异常，需要检查写出结果时先调用Close
+			try {
+				Close();
+			}
+			catch (...) {
+			}
+		}
+
+		ObjWriter(const ObjWriter&) = delete;
+		ObjWriter& operator=(const ObjWriter&) = delete;
+
+		void WriteText(const char* text, size_t length) {
+			if (size + length > BUFFER_SIZE) {
+				Flush();
+			}
+			if (length > BUFFER_SIZE) {
+				f.write(text, length);
+				return;
+			}
+			memcpy(buffer.data() + size, text, length);
+			size += length;
+		}
+
+		void WriteText(const std::string& text) {
+			WriteText(text.data(), text.size());
+		}
+
+		void WriteInt(long long value) {
+			Reserve();
+			size = std::to_chars(buffer.data() + size, buffer.data() + size + MAX_ITEM_SIZE, value).ptr - buffer.data();
+		}
+
+		void WriteFloat(float value) {
+			Reserve();
+			char* first = buffer.data() + size;
+			char* last = first + MAX_ITEM_SIZE;
+			if (floatFormat == ObjFloatFormat::SHORTEST) {
+				size = std::to_chars(first, last, value).ptr - buffer.data();
+			}
+			else {
+				size = std::to_chars(first, last, value, std::chars_format::general, 6).ptr - buffer.data();
+			}
+		}
+
+		// "v x y z\n"
+		void WriteVertex(float x, float y, float z) {
+			WriteText("v ", 2);
+			WriteFloat(x);
+			WriteText(" ", 1);
+			WriteFloat(y);
+			WriteText(" ", 1);
+			WriteFloat(z);
+			WriteText("\n", 1);
+		}
+
+		// "f a b c\n"，索引从1开始
+		void WriteFace(long long a, long long b, long long c) {
+			WriteText("f ", 2);
+			WriteInt(a);
+			WriteText(" ", 1);
+			WriteInt(b);
+			WriteText(" ", 1);
+			WriteInt(c);
+			WriteText("\n", 1);
+		}
+
+		void Flush() {
+			if (size > 0) {
+				f.write(buffer.data(), size);
+				size = 0;
+			}
+		}
+
+		/*
+			写出剩余数据并关闭文件，写出失败时抛出异常
+		*/
+		void Close() {
+			if (!f.is_open()) {
+				return;
+			}
+			Flush();
+			f.close();
+			if (f.fail()) {
+				throw std::runtime_error("Write obj file failed.");
+			}
+		}
+
+	private:
+		void Reserve() {
+			if (size + MAX_ITEM_SIZE > BUFFER_SIZE) {
+				Flush();
+			}
+		}
+
+		ObjFloatFormat floatFormat;
+		std::ofstream f;
+		std::vector<char> buffer;
+		size_t size = 0;
+	};
+
+} // namespace STLNonManifold
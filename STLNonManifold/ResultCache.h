@@ -0,0 +1,527 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <functional>
+#include <filesystem>
+#include <system_error>
+
+#include "STLNonManifold.h"
+
+/*
+	检查结果的磁盘缓存：同一个stl文件再次检查时直接映射缓存文件，跳过读取、合并顶点与构造拓扑
+
+	- 键为输入文件内容的哈希（XXH64）与文件大小、合并容差、合并方式（影响顶点的合并与编号），缓存文件名由键得到
+	- 缓存文件中依次存放：顶点坐标、每个三角形的三个顶点（合并后的索引）、每个三角形的三条边、每条边的起点与终点、
+	  边的关联三角形（CSR）、非流形记录（三角形, 边），各段按8字节对齐，整数为本机字节序
+	- 打开时检查文件头中的键、格式版本与文件大小，任何一项不符都当作未命中，重新检查后覆盖
+	- 先写到同目录的临时文件再改名，多个进程或线程同时写同一个键时读到的总是完整的文件
+*/
+
+namespace STLNonManifold {
+
+	namespace Cache {
+
+		/*
+			XXH64，seed为0
+		*/
+		inline uint64_t HashBytes(const void* data, size_t length, uint64_t seed = 0) {
+			const uint64_t P1 = 11400714785074694791ull;
+			const uint64_t P2 = 14029467366897019727ull;
+			const uint64_t P3 = 1609587929392839161ull;
+			const uint64_t P4 = 9650029242287828579ull;
+			const uint64_t P5 = 2870177450012600261ull;
+
+			auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+			auto read64 = [](const unsigned char* p) { uint64_t v; memcpy(&v, p, sizeof(v)); return v; };
+			auto read32 = [](const unsigned char* p) { uint32_t v; memcpy(&v, p, sizeof(v)); return v; };
+			auto round = [&](uint64_t acc, uint64_t input) { return rotl(acc + input * P2, 31) * P1; };
+			auto merge_round = [&](uint64_t acc, uint64_t value) { return (acc ^ round(0, value)) * P1 + P4; };
+
+			const unsigned char* p = static_cast<const unsigned char*>(data);
+			const unsigned char* end = p + length;
+			uint64_t h;
+
+			if (length >= 32) {
+				uint64_t v1 = seed + P1 + P2;
+				uint64_t v2 = seed + P2;
+				uint64_t v3 = seed;
+				uint64_t v4 = seed - P1;
+				for (; p + 32 <= end; p += 32) {
+					v1 = round(v1, read64(p));
+					v2 = round(v2, read64(p + 8));
+					v3 = round(v3, read64(p + 16));
+					v4 = round(v4, read64(p + 24));
+				}
+				h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+				h = merge_round(h, v1);
+				h = merge_round(h, v2);
+				h = merge_round(h, v3);
+				h = merge_round(h, v4);
+			}
+			else {
+				h = seed + P5;
+			}
+
+			h += static_cast<uint64_t>(length);
+			for (; p + 8 <= end; p += 8) {
+				h = rotl(h ^ round(0, read64(p)), 27) * P1 + P4;
+			}
+			if (p + 4 <= end) {
+				h = rotl(h ^ (static_cast<uint64_t>(read32(p)) * P1), 23) * P2 + P3;
+				p += 4;
+			}
+			for (; p < end; p++) {
+				h = rotl(h ^ (*p * P5), 11) * P1;
+			}
+
+			h ^= h >> 33;
+			h *= P2;
+			h ^= h >> 29;
+			h *= P3;
+			h ^= h >> 32;
+			return h;
+		}
+
+		/*
+			合并结果的种类：结果相同的合并方式共用缓存
+			- UNION_FIND：KDTREE与HASH_GRID（容差内的坐标对在并查集中整体合并），顶点按第一次出现的顺序编号
+			- MORTON：合并与UNION_FIND相同，顶点按Morton码顺序编号
+			0曾是单线程KDTREE逐个Match的合并，已不再使用，这样的旧缓存不会被读取
+		*/
+		enum class WeldVariant : uint32_t {
+			UNION_FIND = 1,
+			MORTON = 2
+		};
+
+		inline WeldVariant GetWeldVariant(const CheckerOptions& options) {
+			if (options.weldMethod == WeldMethod::MORTON) {
+				return WeldVariant::MORTON;
+			}
+			return WeldVariant::UNION_FIND;
+		}
+
+		struct CacheKey {
+			uint64_t contentHash = 0;
+			uint64_t fileSize = 0;
+			float tolerance = STLNonManifold::Geometry::SAME_THRESHOLD;
+			WeldVariant weldVariant = WeldVariant::UNION_FIND;
+
+			/*
+				缓存文件名：内容哈希-文件大小-容差的位-合并方式
+			*/
+			std::string FileName() const {
+				uint32_t tolerance_bits;
+				memcpy(&tolerance_bits, &tolerance, sizeof(tolerance_bits));
+
+				char name[96];
+				snprintf(name, sizeof(name), "%016llx-%llx-%08x-%u.stlnmc", static_cast<unsigned long long>(contentHash), static_cast<unsigned long long>(fileSize),
+					tolerance_bits, static_cast<unsigned int>(weldVariant));
+				return name;
+			}
+		};
+
+		/*
+			映射输入文件计算键，每次都读取全部内容，因此文件被修改（即使大小与修改时间不变）后键也会改变
+		*/
+		inline CacheKey MakeKey(const std::string& stl_file, const CheckerOptions& options) {
+			stl_reader::MappedFile file;
+			file.open(stl_file.c_str());
+
+			CacheKey key;
+			key.contentHash = HashBytes(file.data(), file.size());
+			key.fileSize = file.size();
+			key.weldVariant = GetWeldVariant(options);
+			return key;
+		}
+
+		inline std::string CacheFilePath(const std::string& cache_directory, const CacheKey& key) {
+			return (std::filesystem::path(cache_directory) / key.FileName()).string();
+		}
+
+		// 格式改变时增加
+		const uint32_t CACHE_FORMAT_VERSION = 3;
+		const char CACHE_MAGIC[8] = { 'S', 'T', 'L', 'N', 'M', 'C', 'A', 'C' };
+
+		struct CacheHeader {
+			char magic[8];
+			uint32_t formatVersion;
+			uint32_t headerSize;
+			uint64_t contentHash;
+			uint64_t fileSize;
+			float tolerance;
+			uint32_t weldVariant;
+			int32_t verticesCount;
+			int32_t edgesCount;
+			int32_t trianglesCount;
+			int32_t nonManifoldCount;
+			int32_t incidencesCount; // 所有边的关联三角形数之和
+			int32_t nonManifoldVerticesCount;
+			uint64_t cacheFileSize;
+		};
+		static_assert(sizeof(CacheHeader) == 72, "CacheHeader must not contain padding");
+
+		/*
+			各段在缓存文件中的偏移（字节），由文件头中的个数算出
+		*/
+		struct CacheLayout {
+			size_t vertexCoords;      // float[3 * verticesCount]
+			size_t triangleVertices;  // int32[3 * trianglesCount]
+			size_t triangleEdges;     // int32[3 * trianglesCount]
+			size_t edgeVertices;      // int32[2 * edgesCount]，起点、终点
+			size_t incidenceBegin;    // int32[edgesCount + 1]
+			size_t incidenceTriangles; // int32[incidencesCount]
+			size_t nonManifold;       // int32[2 * nonManifoldCount]，三角形、边
+			size_t nonManifoldVertices; // int32[2 * nonManifoldVerticesCount]，顶点、扇形数
+			size_t end;
+
+			explicit CacheLayout(const CacheHeader& header) {
+				size_t offset = sizeof(CacheHeader);
+				auto section = [&](size_t bytes) {
+					size_t begin = offset;
+					offset = (offset + bytes + 7) & ~size_t(7);
+					return begin;
+				};
+				vertexCoords = section(sizeof(float) * 3 * static_cast<size_t>(header.verticesCount));
+				triangleVertices = section(sizeof(int32_t) * 3 * static_cast<size_t>(header.trianglesCount));
+				triangleEdges = section(sizeof(int32_t) * 3 * static_cast<size_t>(header.trianglesCount));
+				edgeVertices = section(sizeof(int32_t) * 2 * static_cast<size_t>(header.edgesCount));
+				incidenceBegin = section(sizeof(int32_t) * (static_cast<size_t>(header.edgesCount) + 1));
+				incidenceTriangles = section(sizeof(int32_t) * static_cast<size_t>(header.incidencesCount));
+				nonManifold = section(sizeof(int32_t) * 2 * static_cast<size_t>(header.nonManifoldCount));
+				nonManifoldVertices = section(sizeof(int32_t) * 2 * static_cast<size_t>(header.nonManifoldVerticesCount));
+				end = offset;
+			}
+		};
+
+		/*
+			映射的缓存文件，数组直接指向映射的内存
+			输出与STLNonManifoldChecker的CheckNonManifold、Export2OBJ相同
+		*/
+		class CachedResult {
+		public:
+			/*
+				映射并校验缓存文件，文件不存在、损坏、格式版本或键不符时返回false
+			*/
+			bool Open(const std::string& cache_file, const CacheKey& key) {
+				file.close();
+
+				std::error_code ec;
+				if (!std::filesystem::is_regular_file(cache_file, ec)) {
+					return false;
+				}
+				try {
+					file.open(cache_file.c_str());
+				}
+				catch (const std::exception&) {
+					return false;
+				}
+
+				if (file.size() < sizeof(CacheHeader)) {
+					file.close();
+					return false;
+				}
+				memcpy(&header, file.data(), sizeof(CacheHeader));
+
+				bool valid = memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0
+					&& header.formatVersion == CACHE_FORMAT_VERSION
+					&& header.headerSize == sizeof(CacheHeader)
+					&& header.contentHash == key.contentHash
+					&& header.fileSize == key.fileSize
+					&& memcmp(&header.tolerance, &key.tolerance, sizeof(float)) == 0
+					&& header.weldVariant == static_cast<uint32_t>(key.weldVariant)
+					&& header.verticesCount >= 0 && header.edgesCount >= 0 && header.trianglesCount >= 0
+					&& header.nonManifoldCount >= 0 && header.incidencesCount >= 0 && header.nonManifoldVerticesCount >= 0
+					&& header.cacheFileSize == file.size()
+					&& CacheLayout(header).end == file.size();
+				if (!valid) {
+					file.close();
+					return false;
+				}
+
+				CacheLayout layout(header);
+				vertexCoords = Section<float>(layout.vertexCoords);
+				triangleVertices = Section<int32_t>(layout.triangleVertices);
+				triangleEdges = Section<int32_t>(layout.triangleEdges);
+				edgeVertices = Section<int32_t>(layout.edgeVertices);
+				incidenceBegin = Section<int32_t>(layout.incidenceBegin);
+				incidenceTriangles = Section<int32_t>(layout.incidenceTriangles);
+				nonManifold = Section<int32_t>(layout.nonManifold);
+				nonManifoldVertices = Section<int32_t>(layout.nonManifoldVertices);
+
+				if (incidenceBegin[header.edgesCount] != header.incidencesCount) {
+					file.close();
+					return false;
+				}
+				return true;
+			}
+
+			bool IsOpen() const {
+				return file.data() != nullptr;
+			}
+
+			int IncidentTrianglesCount(int edge_id) const {
+				return incidenceBegin[edge_id + 1] - incidenceBegin[edge_id];
+			}
+
+			/*
+				按缓存的非流形记录输出，与STLNonManifoldChecker::CheckNonManifold相同
+			*/
+			int CheckNonManifold() const {
+				for (int i = 0; i < header.nonManifoldCount; i++) {
+					int triangle_id = nonManifold[i * 2];
+					int edge_id = nonManifold[i * 2 + 1];
+					const float* start = &vertexCoords[edgeVertices[edge_id * 2] * 3];
+					const float* end = &vertexCoords[edgeVertices[edge_id * 2 + 1] * 3];
+
+					LOG_INFO("======");
+					LOG_INFO("NonManifold: %d", IncidentTrianglesCount(edge_id));
+					LOG_INFO("Triangle: %d", triangle_id);
+					LOG_INFO("Edge: %d", edge_id);
+					LOG_INFO("Start Vertex: %d (%.5lf, %.5lf, %.5lf)", edgeVertices[edge_id * 2], start[0], start[1], start[2]);
+					LOG_INFO("End Vertex: %d (%.5lf, %.5lf, %.5lf)", edgeVertices[edge_id * 2 + 1], end[0], end[1], end[2]);
+					LOG_INFO("======");
+				}
+
+				std::cout << "Total NonManifold Count: " << header.nonManifoldCount << std::endl;
+				std::cout << "CheckNonManifold end." << std::endl;
+
+				LOG_INFO("Total NonManifold Count: %d", header.nonManifoldCount);
+				LOG_INFO("CheckNonManifold end.");
+
+				return header.nonManifoldCount;
+			}
+
+			/*
+				按缓存的非流形顶点输出，与STLNonManifoldChecker::CheckNonManifoldVertices相同
+			*/
+			int CheckNonManifoldVertices() const {
+				for (int i = 0; i < header.nonManifoldVerticesCount; i++) {
+					int vertex_id = nonManifoldVertices[i * 2];
+					const float* coord = &vertexCoords[vertex_id * 3];
+
+					LOG_INFO("======");
+					LOG_INFO("NonManifold Vertex: %d (%.5lf, %.5lf, %.5lf)", vertex_id, coord[0], coord[1], coord[2]);
+					LOG_INFO("Fans: %d", nonManifoldVertices[i * 2 + 1]);
+					LOG_INFO("======");
+				}
+
+				std::cout << "Total NonManifold Vertex Count: " << header.nonManifoldVerticesCount << std::endl;
+				LOG_INFO("Total NonManifold Vertex Count: %d", header.nonManifoldVerticesCount);
+
+				return header.nonManifoldVerticesCount;
+			}
+
+			/*
+				三角形t是否沿边e的方向（起点到终点）经过它，由角点与边的起点算出
+			*/
+			bool EdgeSense(int triangle_id, int edge_id) const {
+				for (int j = 0; j < 3; j++) {
+					if (triangleEdges[triangle_id * 3 + j] == edge_id) {
+						return triangleVertices[triangle_id * 3 + j] == edgeVertices[edge_id * 2];
+					}
+				}
+				return false;
+			}
+
+			/*
+				方向不一致的边，与Geometry::ForEachInconsistentEdge相同
+			*/
+			template<typename Visitor>
+			void ForEachInconsistentEdge(Visitor&& visitor) const {
+				for (int e = 0; e < header.edgesCount; e++) {
+					if (IncidentTrianglesCount(e) != 2) {
+						continue;
+					}
+					int t0 = incidenceTriangles[incidenceBegin[e]];
+					int t1 = incidenceTriangles[incidenceBegin[e] + 1];
+					if (t0 != t1 && EdgeSense(t0, e) == EdgeSense(t1, e)) {
+						visitor(e, t0, t1);
+					}
+				}
+			}
+
+			int CountInconsistentEdges() const {
+				int inconsistent_count = 0;
+				ForEachInconsistentEdge([&](int, int, int) {
+					inconsistent_count++;
+				});
+				return inconsistent_count;
+			}
+
+			/*
+				由缓存的拓扑输出方向不一致的边，与STLNonManifoldChecker::CheckOrientation相同
+			*/
+			int CheckOrientation() const {
+				int inconsistent_count = 0;
+
+				ForEachInconsistentEdge([&](int e, int t0, int t1) {
+					inconsistent_count++;
+
+					const float* start = &vertexCoords[edgeVertices[e * 2] * 3];
+					const float* end = &vertexCoords[edgeVertices[e * 2 + 1] * 3];
+
+					LOG_INFO("======");
+					LOG_INFO("Inconsistent Orientation Edge: %d", e);
+					LOG_INFO("Triangles: %d %d", t0, t1);
+					LOG_INFO("Start Vertex: %d (%.5lf, %.5lf, %.5lf)", edgeVertices[e * 2], start[0], start[1], start[2]);
+					LOG_INFO("End Vertex: %d (%.5lf, %.5lf, %.5lf)", edgeVertices[e * 2 + 1], end[0], end[1], end[2]);
+					LOG_INFO("======");
+				});
+
+				std::cout << "Total Inconsistent Orientation Count: " << inconsistent_count << std::endl;
+				LOG_INFO("Total Inconsistent Orientation Count: %d", inconsistent_count);
+
+				return inconsistent_count;
+			}
+
+			/*
+				导出OBJ，与STLNonManifoldChecker::Export2OBJ的输出逐字节相同
+			*/
+			void Export2OBJ(const std::string& output_obj_file_path, ObjFloatFormat float_format = ObjFloatFormat::GENERAL_6) const {
+				ObjWriter writer(output_obj_file_path, float_format);
+
+				writer.WriteText("# verticesCount: ");
+				writer.WriteInt(header.verticesCount);
+				writer.WriteText("\n# edgesCount: ");
+				writer.WriteInt(header.edgesCount);
+				writer.WriteText("\n# trianglesCount: ");
+				writer.WriteInt(header.trianglesCount);
+				writer.WriteText("\n");
+
+				for (int i = 0; i < header.verticesCount; i++) {
+					writer.WriteVertex(vertexCoords[i * 3], vertexCoords[i * 3 + 1], vertexCoords[i * 3 + 2]);
+				}
+
+				for (int i = 0; i < header.trianglesCount; i++) {
+					writer.WriteFace(triangleVertices[i * 3] + 1LL, triangleVertices[i * 3 + 1] + 1LL, triangleVertices[i * 3 + 2] + 1LL);
+				}
+
+				writer.Close();
+			}
+
+			CacheHeader header = {};
+			const float* vertexCoords = nullptr;
+			const int32_t* triangleVertices = nullptr;
+			const int32_t* triangleEdges = nullptr;
+			const int32_t* edgeVertices = nullptr;
+			const int32_t* incidenceBegin = nullptr;
+			const int32_t* incidenceTriangles = nullptr;
+			const int32_t* nonManifold = nullptr;
+			const int32_t* nonManifoldVertices = nullptr;
+
+		private:
+			template<typename T>
+			const T* Section(size_t offset) const {
+				return reinterpret_cast<const T*>(file.data() + offset);
+			}
+
+			stl_reader::MappedFile file;
+		};
+
+		/*
+			把checker的结果写入缓存文件，写入失败时返回false（缓存只用于加速，不影响检查）
+		*/
+		inline bool Store(const std::string& cache_file, const CacheKey& key, const STLNonManifoldChecker& checker) {
+			CacheHeader header = {};
+			memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+			header.formatVersion = CACHE_FORMAT_VERSION;
+			header.headerSize = sizeof(CacheHeader);
+			header.contentHash = key.contentHash;
+			header.fileSize = key.fileSize;
+			header.tolerance = key.tolerance;
+			header.weldVariant = static_cast<uint32_t>(key.weldVariant);
+			header.verticesCount = checker.verticesCount;
+			header.edgesCount = checker.edgesCount;
+			header.trianglesCount = checker.trianglesCount;
+
+			const STLNonManifold::Geometry::IndexMesh& topology = checker.topology;
+			std::vector<int32_t> triangle_vertices(static_cast<size_t>(checker.trianglesCount) * 3);
+			std::vector<int32_t> non_manifold;
+			for (int t = 0; t < checker.trianglesCount; t++) {
+				for (int j = 0; j < 3; j++) {
+					triangle_vertices[static_cast<size_t>(t) * 3 + j] = topology.TriangleVertex(t, j);
+
+					// 与CheckNonManifold相同的顺序
+					int e = topology.TriangleEdge(t, j);
+					if (topology.IncidentTrianglesCount(e) != 2) {
+						non_manifold.push_back(t);
+						non_manifold.push_back(e);
+					}
+				}
+			}
+
+			const std::vector<float>& vertex_coords = topology.vertexCoords;
+			const std::vector<int32_t>& triangle_edges = topology.triangleEdges;
+			const std::vector<int32_t>& edge_vertices = topology.edgeVertices;
+			const std::vector<int32_t>& incidence_begin = topology.incidenceBegin;
+			const std::vector<int32_t>& incidence_triangles = topology.incidenceTriangles;
+
+			std::vector<int32_t> non_manifold_vertices;
+			for (int v = 0; v < checker.verticesCount; v++) {
+				if (checker.vertexFans[v] > 1) {
+					non_manifold_vertices.push_back(v);
+					non_manifold_vertices.push_back(checker.vertexFans[v]);
+				}
+			}
+
+			header.nonManifoldCount = static_cast<int32_t>(non_manifold.size() / 2);
+			header.nonManifoldVerticesCount = static_cast<int32_t>(non_manifold_vertices.size() / 2);
+			header.incidencesCount = static_cast<int32_t>(incidence_triangles.size());
+			CacheLayout layout(header);
+			header.cacheFileSize = layout.end;
+
+			// 临时文件名含进程与线程，改名后才对读者可见
+			std::error_code ec;
+			std::filesystem::path cache_path(cache_file);
+			std::filesystem::create_directories(cache_path.parent_path(), ec);
+			std::filesystem::path temp_path = cache_path;
+			temp_path += ".tmp" + std::to_string(Log44::Utils::getPID()) + "_" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+			{
+				std::ofstream f(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+				if (!f.is_open()) {
+					return false;
+				}
+
+				// 依次写出各段，段之间补0到layout中的偏移
+				size_t written = 0;
+				auto put = [&](size_t offset, const void* data, size_t bytes) {
+					const char zeros[8] = {};
+					f.write(zeros, static_cast<std::streamsize>(offset - written));
+					f.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+					written = offset + bytes;
+				};
+				put(0, &header, sizeof(header));
+				put(layout.vertexCoords, vertex_coords.data(), vertex_coords.size() * sizeof(float));
+				put(layout.triangleVertices, triangle_vertices.data(), triangle_vertices.size() * sizeof(int32_t));
+				put(layout.triangleEdges, triangle_edges.data(), triangle_edges.size() * sizeof(int32_t));
+				put(layout.edgeVertices, edge_vertices.data(), edge_vertices.size() * sizeof(int32_t));
+				put(layout.incidenceBegin, incidence_begin.data(), incidence_begin.size() * sizeof(int32_t));
+				put(layout.incidenceTriangles, incidence_triangles.data(), incidence_triangles.size() * sizeof(int32_t));
+				put(layout.nonManifold, non_manifold.data(), non_manifold.size() * sizeof(int32_t));
+				put(layout.nonManifoldVertices, non_manifold_vertices.data(), non_manifold_vertices.size() * sizeof(int32_t));
+				put(layout.end, nullptr, 0);
+
+				f.close();
+				if (f.fail()) {
+					std::filesystem::remove(temp_path, ec);
+					return false;
+				}
+			}
+
+			std::filesystem::rename(temp_path, cache_path, ec);
+			if (ec) {
+				std::filesystem::remove(temp_path, ec);
+				return false;
+			}
+			return true;
+		}
+
+	} // namespace Cache
+
+} // namespace STLNonManifold
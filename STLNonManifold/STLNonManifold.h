@@ -8,6 +8,9 @@
 #include <unordered_map>
 #include <memory>
 #include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <exception>
 
 #include <iostream>
 #include <fstream>
@@ -16,7 +19,14 @@
 
 #include "./stl_reader/stl_reader.h"
 #include "KDTree.h"
+#include "FlatKDTree.h"
+#include "SpatialHashGrid.h"
+#include "MortonGrid.h"
+#include "ConcurrentUnionFind.h"
+#include "TriangleBVH.h"
+#include "TriangleIntersection.h"
 #include "CoreOld.h"
+#include "ObjWriter.h"
 
 template<typename T1, typename T2>
 auto myzip(const T1& container1, const T2& container2) {
@@ -92,7 +102,7 @@ namespace STLNonManifold {
 
 			bool operator==(const Coordinate& other_coord) const {
 				for (int i = 0; i < 3; i++) {
-					if (abs(other_coord.coords[i] - coords[i]) > SAME_THRESHOLD) {
+					if (std::abs(other_coord.coords[i] - coords[i]) > SAME_THRESHOLD) {
 						return false;
 					}
 				}
@@ -118,148 +128,1301 @@ namespace STLNonManifold {
 
 		struct Triangle {
 			std::vector<std::shared_ptr<Edge>> edges;
-			std::vector<bool> edges_senses; // true: һ; false: ת
+			std::vector<bool> edges_senses; // true: 一致; false: 反转
 			int id;
 		};
 
-		
-	}
+		/*
+			用32位下标连接的网格拓扑，各属性存放在连续的数组中（SoA），代替shared_ptr连接的Vertex/Edge/Triangle
+			- 顶点v的坐标为vertexCoords[3v, 3v + 3)
+			- 三角形t的第j条边（第j个角点到第j+1个角点）为triangleEdges[3t + j]；
+			  triangleSenses[t]的第j位为1时三角形沿边的方向（起点到终点）经过该边，为0时反向经过
+			- 边e的起点、终点为edgeVertices[2e]、edgeVertices[2e + 1]，即构造时第一个经过它的三角形中的方向
+			- 边e的关联三角形为incidenceTriangles[incidenceBegin[e], incidenceBegin[e + 1])（CSR），按三角形编号递增
+		*/
+		struct IndexMesh {
+			std::vector<T_NUM> vertexCoords;
+			std::vector<int32_t> triangleEdges;
+			std::vector<uint8_t> triangleSenses;
+			std::vector<int32_t> edgeVertices;
+			std::vector<int32_t> incidenceBegin;
+			std::vector<int32_t> incidenceTriangles;
+
+			int VerticesCount() const {
+				return static_cast<int>(vertexCoords.size() / 3);
+			}
 
-	struct STLNonManifoldChecker {
+			int EdgesCount() const {
+				return static_cast<int>(edgeVertices.size() / 2);
+			}
+
+			int TrianglesCount() const {
+				return static_cast<int>(triangleSenses.size());
+			}
 
-		STLNonManifoldChecker(const std::string& stl_file): mesh(stl_file) {
+			const T_NUM* VertexCoord(int v) const {
+				return &vertexCoords[static_cast<size_t>(v) * 3];
+			}
 
-			// ȡ
-			std::vector<STLNonManifold::Geometry::Coordinate> coordinates;
-			int coords_count = 0;
-			for (size_t i_solid = 0; i_solid < mesh.num_solids(); i_solid++) {
-				for (size_t j_tri = mesh.solid_tris_begin(i_solid); j_tri < mesh.solid_tris_end(i_solid); j_tri++) {
+			int EdgeStart(int e) const {
+				return edgeVertices[static_cast<size_t>(e) * 2];
+			}
+
+			int EdgeEnd(int e) const {
+				return edgeVertices[static_cast<size_t>(e) * 2 + 1];
+			}
 
-					// ҿȻصָ룿
-					STLNonManifold::Geometry::Coordinate coord0(mesh.tri_corner_coords(j_tri, 0), coords_count++);
-					STLNonManifold::Geometry::Coordinate coord1(mesh.tri_corner_coords(j_tri, 1), coords_count++);
-					STLNonManifold::Geometry::Coordinate coord2(mesh.tri_corner_coords(j_tri, 2), coords_count++);
+			int TriangleEdge(int t, int j) const {
+				return triangleEdges[static_cast<size_t>(t) * 3 + j];
+			}
+
+			bool EdgeSense(int t, int j) const {
+				return (triangleSenses[t] >> j) & 1;
+			}
+
+			/*
+				三角形t的第j个角点
+			*/
+			int TriangleVertex(int t, int j) const {
+				int e = TriangleEdge(t, j);
+				return EdgeSense(t, j) ? EdgeStart(e) : EdgeEnd(e);
+			}
+
+			int IncidentTrianglesCount(int e) const {
+				return incidenceBegin[e + 1] - incidenceBegin[e];
+			}
 
-					coordinates.emplace_back(coord0);
-					coordinates.emplace_back(coord1);
-					coordinates.emplace_back(coord2);
+			/*
+				边e在三角形t中的序号j（TriangleEdge(t, j) == e），不在t中时返回-1
+			*/
+			int EdgeIndexInTriangle(int t, int e) const {
+				for (int j = 0; j < 3; j++) {
+					if (TriangleEdge(t, j) == e) {
+						return j;
+					}
 				}
+				return -1;
 			}
-			
-			// KDTreeȥ
-			KDTree<STLNonManifold::Geometry::Coordinate, STLNonManifold::Geometry::T_NUM> kdtree(coordinates);
-			std::vector<int> coordinates_indices(coords_count);
-			std::vector<bool> coordinates_indices_flag(coords_count);
-			for (int i = 0; i < coords_count; i++) {
-
-				if (coordinates_indices_flag[i] == false) {
-					auto same_coords = kdtree.Match(coordinates[i]);
-					auto min_it = std::min_element(same_coords.begin(), same_coords.end(), [&](const STLNonManifold::Geometry::Coordinate& a, const STLNonManifold::Geometry::Coordinate& b) {return a.GetId() < b.GetId(); });
-					int min_id = min_it->GetId();
-
-					for (auto&& coord : same_coords) {
-						int coord_id = coord.GetId();
-						coordinates_indices[coord_id] = min_id;
-						coordinates_indices_flag[coord_id] = true;
+
+			/*
+				反转三角形t的方向：角点(a, b, c)变为(a, c, b)，新的第j条边为原来的第2 - j条边，经过方向相反
+			*/
+			void FlipTriangle(int t) {
+				std::swap(triangleEdges[static_cast<size_t>(t) * 3], triangleEdges[static_cast<size_t>(t) * 3 + 2]);
+				uint8_t senses = triangleSenses[t];
+				uint8_t flipped_senses = 0;
+				for (int j = 0; j < 3; j++) {
+					if (!((senses >> (2 - j)) & 1)) {
+						flipped_senses |= 1 << j;
+					}
+				}
+				triangleSenses[t] = flipped_senses;
+			}
+
+			/*
+				各数组占用的内存（字节）
+			*/
+			size_t MemoryBytes() const {
+				return vertexCoords.capacity() * sizeof(T_NUM) + triangleEdges.capacity() * sizeof(int32_t) + triangleSenses.capacity() * sizeof(uint8_t)
+					+ edgeVertices.capacity() * sizeof(int32_t) + incidenceBegin.capacity() * sizeof(int32_t) + incidenceTriangles.capacity() * sizeof(int32_t);
+			}
+		};
+
+	}
+
+	using StlMeshType = stl_reader::StlMesh<STLNonManifold::Geometry::T_NUM, unsigned int>;
+	using StlBinaryViewType = stl_reader::StlBinaryView<STLNonManifold::Geometry::T_NUM>;
+
+	/*
+		合并坐标的方式
+		- KDTREE：各线程在FlatKDTree中Match每个坐标（与id较小的坐标完全相同的除外），用无锁并查集合并，合并链整体合并
+		- HASH_GRID：SpatialHashGrid中查询每个坐标的邻近格子，用并查集合并，期望线性时间
+		- MORTON：按Morton码排序的MortonGrid中查找邻近格子，用并查集合并；合并结果与HASH_GRID相同，
+		  构造拓扑时顶点按Morton码顺序编号（空间上相近的顶点编号相近），因此导出的顶点顺序与其他方式不同
+	*/
+	enum class WeldMethod {
+		KDTREE,
+		HASH_GRID,
+		MORTON
+	};
+
+	/*
+		读取相关的选项
+	*/
+	struct CheckerOptions {
+		// 二进制文件使用内存映射的零拷贝读取（ASCII文件仍走StlMesh）
+		bool mappedBinaryReader = false;
+
+		// 线程数，0表示使用全部硬件线程
+		unsigned int numThreads = 1;
+
+		// 流式检查（StreamingNonManifoldChecker）的内存预算与临时文件目录，目录为空时使用系统临时目录
+		size_t memoryBudgetMB = 256;
+		std::string spillDirectory;
+
+		// 合并坐标的方式
+		WeldMethod weldMethod = WeldMethod::KDTREE;
+
+		// 检查结果的缓存目录（见ResultCache.h），为空时不使用缓存
+		std::string cacheDirectory;
+	};
+
+	/*
+		逐三角形取出所有角点坐标（未去重），id按取出顺序编号
+	*/
+	inline std::vector<STLNonManifold::Geometry::Coordinate> CollectCoordinates(const StlMeshType& mesh) {
+		std::vector<STLNonManifold::Geometry::Coordinate> coordinates;
+		coordinates.reserve(mesh.num_tris() * 3);
+
+		int coords_count = 0;
+		for (size_t i_solid = 0; i_solid < mesh.num_solids(); i_solid++) {
+			for (size_t j_tri = mesh.solid_tris_begin(i_solid); j_tri < mesh.solid_tris_end(i_solid); j_tri++) {
+
+				// 我靠，居然返回的是指针？？？
+				STLNonManifold::Geometry::Coordinate coord0(mesh.tri_corner_coords(j_tri, 0), coords_count++);
+				STLNonManifold::Geometry::Coordinate coord1(mesh.tri_corner_coords(j_tri, 1), coords_count++);
+				STLNonManifold::Geometry::Coordinate coord2(mesh.tri_corner_coords(j_tri, 2), coords_count++);
+
+				coordinates.emplace_back(coord0);
+				coordinates.emplace_back(coord1);
+				coordinates.emplace_back(coord2);
+			}
+		}
+
+		return coordinates;
+	}
+
+	/*
+		直接从映射的二进制记录中取出角点坐标，不经过StlMesh的coordsWithIndex和去重
+		与RemoveDoubles一致：跳过有两个角点完全相同的退化三角形
+	*/
+	inline std::vector<STLNonManifold::Geometry::Coordinate> CollectCoordinates(const StlBinaryViewType& view) {
+		std::vector<STLNonManifold::Geometry::Coordinate> coordinates(view.num_tris() * 3);
+
+		auto exactly_equal = [](const STLNonManifold::Geometry::Coordinate& a, const STLNonManifold::Geometry::Coordinate& b) {
+			return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+		};
+
+		size_t coords_count = 0;
+		for (size_t j_tri = 0; j_tri < view.num_tris(); j_tri++) {
+			STLNonManifold::Geometry::Coordinate* corners = &coordinates[coords_count];
+			for (size_t k = 0; k < 3; k++) {
+				view.tri_corner_coords(j_tri, k, corners[k].coords);
+				corners[k].SetId(static_cast<int>(coords_count + k));
+			}
+
+			if (exactly_equal(corners[0], corners[1]) || exactly_equal(corners[0], corners[2]) || exactly_equal(corners[1], corners[2])) {
+				continue;
+			}
+			coords_count += 3;
+		}
+		coordinates.resize(coords_count);
+
+		return coordinates;
+	}
+
+	/*
+		并查集中每个下标所在集合的根，num_threads个线程各处理一段
+	*/
+	inline std::vector<int> CollectRoots(ConcurrentUnionFind& union_find, unsigned int num_threads) {
+		int count = union_find.Size();
+		std::vector<int> roots(count);
+
+		stl_reader::stl_reader_impl::RunParallel(num_threads, [&](size_t t) {
+			int begin = static_cast<int>(static_cast<long long>(count) * t / num_threads);
+			int end = static_cast<int>(static_cast<long long>(count) * (t + 1) / num_threads);
+			for (int i = begin; i < end; i++) {
+				roots[i] = union_find.Find(i);
+			}
+		});
+
+		return roots;
+	}
+
+	/*
+		构造FlatKDTree合并坐标：各线程依次领取一批坐标Match，与匹配到的坐标在无锁并查集中合并，
+		每个集合取其中最小的id，合并链（a与b、b与c在容差内而a与c不在）整体合并
+		coordinates[i]的id必须为i，返回每个坐标合并后的id；单线程也经过并查集，结果与线程数无关
+		与id较小的坐标完全相同的坐标匹配到的坐标也相同，已与它合并后不再Match（是否跳过与线程的执行顺序有关，但集合不变）
+	*/
+	inline std::vector<int> WeldCoordinates_KDTree(const std::vector<STLNonManifold::Geometry::Coordinate>& coordinates, unsigned int num_threads = 1) {
+		const int WELD_BATCH_SIZE = 4096;
+		int coords_count = static_cast<int>(coordinates.size());
+
+		FlatKDTree<STLNonManifold::Geometry::Coordinate, STLNonManifold::Geometry::T_NUM> kdtree(coordinates, num_threads);
+		ConcurrentUnionFind union_find(coords_count);
+
+		std::vector<std::atomic<bool>> exact_duplicates(coords_count);
+		for (auto&& flag : exact_duplicates) {
+			flag.store(false, std::memory_order_relaxed);
+		}
+
+		std::atomic<int> next_coord(0);
+		stl_reader::stl_reader_impl::RunParallel(num_threads, [&](size_t) {
+			for (int begin = next_coord.fetch_add(WELD_BATCH_SIZE); begin < coords_count; begin = next_coord.fetch_add(WELD_BATCH_SIZE)) {
+				int end = std::min(begin + WELD_BATCH_SIZE, coords_count);
+				for (int i = begin; i < end; i++) {
+					if (exact_duplicates[i].load(std::memory_order_relaxed)) {
+						continue;
 					}
 
+					// 每对坐标在两边的查询中各出现一次，只在id较大的一边合并；id较大且完全相同的坐标在这里合并并标记
+					const STLNonManifold::Geometry::Coordinate& coord = coordinates[i];
+					kdtree.ForEachMatch(coord, [&](int j) {
+						const STLNonManifold::Geometry::Coordinate& other_coord = kdtree.points[j];
+						int coord_id = other_coord.GetId();
+						if (coord_id < i) {
+							union_find.Unite(coord_id, i);
+						}
+						else if (coord_id > i && other_coord[0] == coord[0] && other_coord[1] == coord[1] && other_coord[2] == coord[2]) {
+							union_find.Unite(i, coord_id);
+							exact_duplicates[coord_id].store(true, std::memory_order_relaxed);
+						}
+					});
 				}
+			}
+		});
+
+		return CollectRoots(union_find, num_threads);
+	}
+
+	/*
+		构造SpatialHashGrid合并坐标：容差内的每一对坐标在无锁并查集中合并，集合的根始终为其中最小的id
+		coordinates[i]的id必须为i，返回每个坐标合并后的id
+		各线程依次领取一段格子查找坐标对，结果与线程数无关，与WeldCoordinates_KDTree相同
+	*/
+	inline std::vector<int> WeldCoordinates_HashGrid(const std::vector<STLNonManifold::Geometry::Coordinate>& coordinates, unsigned int num_threads = 1) {
+		const int WELD_BATCH_CELLS = 1024;
+		int coords_count = static_cast<int>(coordinates.size());
+
+		SpatialHashGrid<STLNonManifold::Geometry::Coordinate, STLNonManifold::Geometry::T_NUM> grid(coordinates);
+		ConcurrentUnionFind union_find(coords_count);
+
+		int cells_count = grid.CellsCount();
+		std::atomic<int> next_cell(0);
+		stl_reader::stl_reader_impl::RunParallel(num_threads, [&](size_t) {
+			for (int begin = next_cell.fetch_add(WELD_BATCH_CELLS); begin < cells_count; begin = next_cell.fetch_add(WELD_BATCH_CELLS)) {
+				grid.ForEachMatchedPair([&](const STLNonManifold::Geometry::Coordinate& a, const STLNonManifold::Geometry::Coordinate& b) {
+					union_find.Unite(a.GetId(), b.GetId());
+				}, begin, std::min(begin + WELD_BATCH_CELLS, cells_count));
+			}
+		});
+
+		return CollectRoots(union_find, num_threads);
+	}
+
+	/*
+		构造MortonGrid合并坐标，与WeldCoordinates_HashGrid相同地用无锁并查集合并容差内的每一对坐标，结果与之相同
+		vertex_order不为空时填入合并后的代表坐标（每个集合中最小的id），按Morton码顺序排列
+	*/
+	inline std::vector<int> WeldCoordinates_Morton(const std::vector<STLNonManifold::Geometry::Coordinate>& coordinates, unsigned int num_threads = 1, std::vector<int>* vertex_order = nullptr) {
+		const int WELD_BATCH_CELLS = 1024;
+		int coords_count = static_cast<int>(coordinates.size());
+
+		MortonGrid<STLNonManifold::Geometry::Coordinate, STLNonManifold::Geometry::T_NUM> grid(coordinates, num_threads);
+		ConcurrentUnionFind union_find(coords_count);
+
+		int cells_count = grid.CellsCount();
+		std::atomic<int> next_cell(0);
+		stl_reader::stl_reader_impl::RunParallel(num_threads, [&](size_t) {
+			for (int begin = next_cell.fetch_add(WELD_BATCH_CELLS); begin < cells_count; begin = next_cell.fetch_add(WELD_BATCH_CELLS)) {
+				grid.ForEachMatchedPair([&](const STLNonManifold::Geometry::Coordinate& a, const STLNonManifold::Geometry::Coordinate& b) {
+					union_find.Unite(a.GetId(), b.GetId());
+				}, begin, std::min(begin + WELD_BATCH_CELLS, cells_count));
+			}
+		});
+
+		std::vector<int> coordinates_indices = CollectRoots(union_find, num_threads);
+
+		if (vertex_order != nullptr) {
+			vertex_order->clear();
+			for (auto&& coord : grid.points) {
+				if (coordinates_indices[coord.GetId()] == coord.GetId()) {
+					vertex_order->push_back(coord.GetId());
+				}
+			}
+		}
+
+		return coordinates_indices;
+	}
+
+	/*
+		按weld_method合并坐标，coordinates[i]的id必须为i，返回每个坐标合并后的id
+		num_threads为0时使用全部硬件线程
+	*/
+	inline std::vector<int> WeldCoordinates(const std::vector<STLNonManifold::Geometry::Coordinate>& coordinates, WeldMethod weld_method = WeldMethod::KDTREE, unsigned int num_threads = 1) {
+		num_threads = stl_reader::stl_reader_impl::ResolveNumThreads(num_threads);
+
+		if (weld_method == WeldMethod::HASH_GRID) {
+			return WeldCoordinates_HashGrid(coordinates, num_threads);
+		}
+		if (weld_method == WeldMethod::MORTON) {
+			return WeldCoordinates_Morton(coordinates, num_threads);
+		}
+		return WeldCoordinates_KDTree(coordinates, num_threads);
+	}
+
+	/*
+		构造拓扑所用的合并：返回每个坐标合并后的id，vertex_order为创建顶点的顺序（合并后的代表id，每个只出现一次）
+		MORTON时按Morton码顺序，其他方式按id递增（代表id为集合中最小的id，即按坐标第一次出现的顺序）
+	*/
+	inline std::vector<int> WeldCoordinatesForTopology(const std::vector<STLNonManifold::Geometry::Coordinate>& coordinates, const CheckerOptions& options, std::vector<int>& vertex_order) {
+		if (options.weldMethod == WeldMethod::MORTON) {
+			return WeldCoordinates_Morton(coordinates, stl_reader::stl_reader_impl::ResolveNumThreads(options.numThreads), &vertex_order);
+		}
+
+		std::vector<int> coordinates_indices = WeldCoordinates(coordinates, options.weldMethod, options.numThreads);
+		vertex_order.clear();
+		for (int i = 0; i < static_cast<int>(coordinates_indices.size()); i++) {
+			if (coordinates_indices[i] == i) {
+				vertex_order.push_back(i);
+			}
+		}
+		return coordinates_indices;
+	}
+
+	/*
+		边（两个顶点编号，较小的在前）的哈希值，用于BuildIndexMesh中开放寻址的边表
+	*/
+	inline size_t HashEdgeKey(int a, int b) {
+		unsigned long long h = ((static_cast<unsigned long long>(static_cast<unsigned int>(a)) << 32) | static_cast<unsigned int>(b)) * 0x9E3779B97F4A7C15ull;
+		return static_cast<size_t>(h ^ (h >> 32));
+	}
+
+	/*
+		多线程构造IndexMesh，结果与单线程的BuildIndexMesh完全相同：
+		- 顶点：vertex_order中的id不能重复（WeldCoordinatesForTopology的结果），顶点编号即在vertex_order中的位置
+		- 边：三角形t的第j条边为半边3t + j。各线程为自己的一段三角形写出半边的键，按键的哈希值分区，分区内的半边保持编号递增，
+		  每个分区约PARTITION_HALF_EDGES个半边，使分区的哈希表能留在缓存中
+		- 每个分区用自己的开放寻址表找出每条边第一次出现的半边、每个半边在边的关联半边中的序号与每条边的关联半边数
+		- 第一次出现的半边各段计数后前缀和得到边编号，即按三角形顺序第一次出现时编号；关联三角形按序号直接填入
+	*/
+	inline STLNonManifold::Geometry::IndexMesh BuildIndexMesh_Parallel(const std::vector<STLNonManifold::Geometry::Coordinate>& coordinates, const std::vector<int>& coordinates_indices, const std::vector<int>& vertex_order, unsigned int num_threads) {
+		const int PARTITION_HALF_EDGES = 65536;
+		STLNonManifold::Geometry::IndexMesh topology;
+		int coords_count = static_cast<int>(coordinates.size());
+		int triangles_count = coords_count / 3;
+		int half_edges_count = triangles_count * 3;
+		size_t num_ranges = num_threads;
+
+		// [0, n)的第r段的起点
+		auto range_begin = [&](int n, size_t r) {
+			return static_cast<int>(static_cast<long long>(n) * static_cast<long long>(r) / static_cast<long long>(num_ranges));
+		};
+
+		// 各段的计数转为各段的起点，返回总数
+		auto exclusive_scan = [&](std::vector<int>& range_counts) {
+			int total = 0;
+			for (size_t r = 0; r < num_ranges; r++) {
+				int count = range_counts[r];
+				range_counts[r] = total;
+				total += count;
+			}
+			return total;
+		};
 
-				// [debug]
-				//std::cout << i << ": ";
-				//for (auto&& coord : same_coords) {
-				//	std::cout << coord.GetId() <<" ";
-				//	std::cout << "(" << coord[0] << ", " << coord[1] << ", " << coord[2] << "), ";
-				//}
-				//std::cout << std::endl;
+		// 顶点：vertex_order中每个id只出现一次，第v个为顶点v
+		int vertices_count = static_cast<int>(vertex_order.size());
+		std::vector<int> vertex_ids(coords_count, -1);
+		topology.vertexCoords.resize(static_cast<size_t>(vertices_count) * 3);
+		stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t r) {
+			for (int v = range_begin(vertices_count, r); v < range_begin(vertices_count, r + 1); v++) {
+				vertex_ids[vertex_order[v]] = v;
+				for (int i = 0; i < 3; i++) {
+					topology.vertexCoords[static_cast<size_t>(v) * 3 + i] = coordinates[vertex_order[v]][i];
+				}
 			}
+		});
+
+		// 角点的顶点编号：半边h的起点为角点h，终点为同一三角形的下一个角点
+		std::vector<int32_t> corner_vertices(half_edges_count);
+		auto half_edge_end = [&](int h) {
+			return corner_vertices[h % 3 == 2 ? h - 2 : h + 1];
+		};
+		// 边的键：较小的顶点在高32位
+		auto half_edge_key = [&](int h) {
+			int start = corner_vertices[h], end = half_edge_end(h);
+			return (static_cast<unsigned long long>(std::min(start, end)) << 32) | static_cast<unsigned int>(std::max(start, end));
+		};
+		auto key_hash = [](unsigned long long key) {
+			return HashEdgeKey(static_cast<int>(key >> 32), static_cast<int>(key & 0xFFFFFFFFull));
+		};
 
-			 //[debug]
-			//for (auto&& id : coordinates_indices) {
-			//	std::cout << id << ", ";
-			//}
-			//std::cout << std::endl;
+		// 分区数不少于线程数，各线程依次领取分区
+		size_t num_partitions = std::max(num_ranges, static_cast<size_t>(half_edges_count / PARTITION_HALF_EDGES));
+		auto for_each_partition = [&](auto&& func) {
+			std::atomic<size_t> next_partition(0);
+			stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t) {
+				for (size_t p = next_partition.fetch_add(1); p < num_partitions; p = next_partition.fetch_add(1)) {
+					func(p);
+				}
+			});
+		};
 
-			// ˣ춥
-			// עvertexidǰϲ¸ֵ
-			int vertices_count = 0;
-			std::map<int, std::shared_ptr<STLNonManifold::Geometry::Vertex>> vertices_map; // merged_index -> vertex
-			for (int i = 0; i < coords_count;i++) {
-				int vertex_merged_index = coordinates_indices[i];
-				auto it = vertices_map.find(vertex_merged_index);
+		stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t r) {
+			for (int c = range_begin(triangles_count, r) * 3; c < range_begin(triangles_count, r + 1) * 3; c++) {
+				corner_vertices[c] = vertex_ids[coordinates_indices[c]];
+			}
+		});
 
-				// ûҵѾĶ㣺
-				if (it == vertices_map.end()) {
+		std::vector<int> partition_counts(num_ranges * num_partitions, 0); // [三角形段 * num_partitions + 分区]
+		stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t r) {
+			std::vector<int> counts(num_partitions, 0);
+			for (int h = range_begin(triangles_count, r) * 3; h < range_begin(triangles_count, r + 1) * 3; h++) {
+				counts[key_hash(half_edge_key(h)) % num_partitions]++;
+			}
+			std::copy(counts.begin(), counts.end(), partition_counts.begin() + r * num_partitions);
+		});
+
+		// 分区p的半边为[partition_begin[p], partition_begin[p + 1])，先按分区再按三角形段排列
+		std::vector<int> partition_begin(num_partitions + 1, 0);
+		std::vector<int> partition_fill(num_ranges * num_partitions);
+		for (size_t p = 0; p < num_partitions; p++) {
+			int offset = partition_begin[p];
+			for (size_t r = 0; r < num_ranges; r++) {
+				partition_fill[r * num_partitions + p] = offset;
+				offset += partition_counts[r * num_partitions + p];
+			}
+			partition_begin[p + 1] = offset;
+		}
 
-					auto vertex_ptr = std::make_shared<STLNonManifold::Geometry::Vertex>();
-					auto coord_ptr = std::make_shared<STLNonManifold::Geometry::Coordinate>(coordinates[vertex_merged_index]); // 
+		std::vector<unsigned long long> partition_keys(half_edges_count);
+		std::vector<int32_t> partition_half_edges(half_edges_count);
+		stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t r) {
+			std::vector<int> fill(partition_fill.begin() + r * num_partitions, partition_fill.begin() + (r + 1) * num_partitions);
+			for (int h = range_begin(triangles_count, r) * 3; h < range_begin(triangles_count, r + 1) * 3; h++) {
+				unsigned long long key = half_edge_key(h);
+				int k = fill[key_hash(key) % num_partitions]++;
+				partition_keys[k] = key;
+				partition_half_edges[k] = h;
+			}
+		});
 
-					// 춥
-					vertex_ptr->id = vertices_count;
-					vertex_ptr->pointCoord = coord_ptr;
-					coord_ptr->id = vertices_count;
+		// 每个分区的开放寻址表：边的键 -> 第一次出现的半边与已出现的次数，哈希值除以分区数后作为位置
+		struct EdgeSlot {
+			unsigned long long key;
+			int32_t firstHalfEdge;
+			int32_t count;
+		};
+		const unsigned long long EMPTY_KEY = ~0ull;
+		std::vector<int32_t> first_half_edges(half_edges_count);
+		std::vector<int32_t> incidence_ranks(half_edges_count); // 半边在其边的关联半边中的序号
+		std::vector<int32_t> incidence_counts(half_edges_count); // 第一次出现的半边处保存边的关联半边数
+		for_each_partition([&](size_t p) {
+			size_t capacity = 16;
+			while (capacity < static_cast<size_t>(partition_begin[p + 1] - partition_begin[p]) * 2) {
+				capacity <<= 1;
+			}
+			std::vector<EdgeSlot> edges_table(capacity, EdgeSlot{ EMPTY_KEY, -1, 0 });
+			for (int k = partition_begin[p]; k < partition_begin[p + 1]; k++) {
+				unsigned long long key = partition_keys[k];
+				size_t slot = (key_hash(key) / num_partitions) & (capacity - 1);
+				while (edges_table[slot].key != EMPTY_KEY && edges_table[slot].key != key) {
+					slot = (slot + 1) & (capacity - 1);
+				}
 
-					vertices_map[vertex_merged_index] = vertex_ptr;
-					vertices_count++;
+				EdgeSlot& edge_slot = edges_table[slot];
+				int h = partition_half_edges[k];
+				if (edge_slot.key == EMPTY_KEY) {
+					edge_slot.key = key;
+					edge_slot.firstHalfEdge = h;
 				}
+				first_half_edges[h] = edge_slot.firstHalfEdge;
+				incidence_ranks[h] = edge_slot.count++;
 			}
 
-			// ˣεȥ
-			int edges_count = 0;
-			int triangles_count = 0;
-			std::map<std::pair<int, int>, std::shared_ptr<STLNonManifold::Geometry::Edge>> edges_map; // (merge_index, merged_index) -> edge
-			for (int i = 0; i< coords_count; i += 3) {
-				// 
-				std::shared_ptr<STLNonManifold::Geometry::Triangle> triangle_ptr = std::make_shared<STLNonManifold::Geometry::Triangle>();
-				triangle_ptr->id = i/3;
+			for (const EdgeSlot& edge_slot : edges_table) {
+				if (edge_slot.key != EMPTY_KEY) {
+					incidence_counts[edge_slot.firstHalfEdge] = edge_slot.count;
+				}
+			}
+		});
+
+		// 边编号：第一次出现的半边创建边
+		std::vector<int> range_edges(num_ranges, 0);
+		stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t r) {
+			int count = 0;
+			for (int h = range_begin(triangles_count, r) * 3; h < range_begin(triangles_count, r + 1) * 3; h++) {
+				if (first_half_edges[h] == h) {
+					count++;
+				}
+			}
+			range_edges[r] = count;
+		});
+		int edges_count = exclusive_scan(range_edges);
+
+		// 创建边，incidenceBegin先按边保存关联半边数，各段的关联半边数用于前缀和
+		topology.triangleEdges.resize(half_edges_count);
+		topology.triangleSenses.resize(triangles_count);
+		topology.edgeVertices.resize(static_cast<size_t>(edges_count) * 2);
+		topology.incidenceBegin.resize(static_cast<size_t>(edges_count) + 1);
+		topology.incidenceBegin[0] = 0;
+		std::vector<int> range_incidences(num_ranges, 0);
+		stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t r) {
+			int e = range_edges[r];
+			int incidences = 0;
+			for (int h = range_begin(triangles_count, r) * 3; h < range_begin(triangles_count, r + 1) * 3; h++) {
+				if (first_half_edges[h] == h) {
+					topology.triangleEdges[h] = e;
+					topology.edgeVertices[static_cast<size_t>(e) * 2] = corner_vertices[h];
+					topology.edgeVertices[static_cast<size_t>(e) * 2 + 1] = half_edge_end(h);
+					topology.incidenceBegin[e + 1] = incidence_counts[h];
+					incidences += incidence_counts[h];
+					e++;
+				}
+			}
+			range_incidences[r] = incidences;
+		});
+
+		exclusive_scan(range_incidences);
+		stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t r) {
+			int offset = range_incidences[r];
+			for (int e = range_edges[r]; e < (r + 1 < num_ranges ? range_edges[r + 1] : edges_count); e++) {
+				offset += topology.incidenceBegin[e + 1];
+				topology.incidenceBegin[e + 1] = offset;
+			}
+		});
 
-				// 
+		// 其余的半边取第一次出现的半边的边编号，并按序号填入关联三角形
+		topology.incidenceTriangles.resize(half_edges_count);
+		stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t r) {
+			for (int t = range_begin(triangles_count, r); t < range_begin(triangles_count, r + 1); t++) {
+				uint8_t senses = 0;
 				for (int j = 0; j < 3; j++) {
+					int h = t * 3 + j;
+					int e = topology.triangleEdges[first_half_edges[h]];
+					topology.triangleEdges[h] = e;
+					if (topology.EdgeStart(e) == corner_vertices[h]) {
+						senses |= 1 << j;
+					}
+					topology.incidenceTriangles[topology.incidenceBegin[e] + incidence_ranks[h]] = t;
+				}
+				topology.triangleSenses[t] = senses;
+			}
+		});
+
+		return topology;
+	}
+
+	/*
+		由合并结果构造IndexMesh：顶点按vertex_order编号，边按三角形顺序第一次出现时编号，与原来的shared_ptr图（BuildTopologyGraph）编号相同
+		num_threads为0时使用全部硬件线程，多线程且三角形较多时使用BuildIndexMesh_Parallel，结果相同
+	*/
+	inline STLNonManifold::Geometry::IndexMesh BuildIndexMesh(const std::vector<STLNonManifold::Geometry::Coordinate>& coordinates, const std::vector<int>& coordinates_indices, const std::vector<int>& vertex_order, unsigned int num_threads = 1) {
+		const int MIN_PARALLEL_TRIANGLES = 65536;
+		int coords_count = static_cast<int>(coordinates.size());
+		int triangles_count = coords_count / 3;
+
+		num_threads = stl_reader::stl_reader_impl::ResolveNumThreads(num_threads);
+		if (num_threads > 1 && triangles_count >= MIN_PARALLEL_TRIANGLES) {
+			return BuildIndexMesh_Parallel(coordinates, coordinates_indices, vertex_order, num_threads);
+		}
+
+		STLNonManifold::Geometry::IndexMesh topology;
+
+		// 顶点：合并后的id -> 顶点编号
+		std::vector<int> vertex_ids(coords_count, -1);
+		int vertices_count = 0;
+		for (int vertex_merged_index : vertex_order) {
+			if (vertex_ids[vertex_merged_index] < 0) {
+				vertex_ids[vertex_merged_index] = vertices_count++;
+				for (int i = 0; i < 3; i++) {
+					topology.vertexCoords.push_back(coordinates[vertex_merged_index][i]);
+				}
+			}
+		}
+
+		// 边：开放寻址的哈希表，键为(较小的顶点, 较大的顶点)，保存边编号，-1为空
+		// 边数不超过3T，容量为不小于2倍3T的2的幂，装载因子不超过1/2
+		topology.triangleEdges.resize(static_cast<size_t>(triangles_count) * 3);
+		topology.triangleSenses.resize(triangles_count);
+		size_t capacity = 16;
+		while (capacity < topology.triangleEdges.size() * 2) {
+			capacity <<= 1;
+		}
+		std::vector<int32_t> edges_table(capacity, -1);
+		for (int t = 0; t < triangles_count; t++) {
+			uint8_t senses = 0;
+			for (int j = 0; j < 3; j++) {
+				int start = vertex_ids[coordinates_indices[t * 3 + j]];
+				int end = vertex_ids[coordinates_indices[t * 3 + (j + 1) % 3]];
+
+				size_t slot = HashEdgeKey(std::min(start, end), std::max(start, end)) & (capacity - 1);
+				int e = edges_table[slot];
+				while (e >= 0 && !((topology.EdgeStart(e) == start && topology.EdgeEnd(e) == end) || (topology.EdgeStart(e) == end && topology.EdgeEnd(e) == start))) {
+					slot = (slot + 1) & (capacity - 1);
+					e = edges_table[slot];
+				}
+				if (e < 0) {
+					e = topology.EdgesCount();
+					edges_table[slot] = e;
+					topology.edgeVertices.push_back(start);
+					topology.edgeVertices.push_back(end);
+				}
+
+				topology.triangleEdges[t * 3 + j] = e;
+				if (topology.EdgeStart(e) == start) {
+					senses |= 1 << j;
+				}
+			}
+			topology.triangleSenses[t] = senses;
+		}
+
+		// 关联三角形：先计数再按三角形顺序填入
+		int edges_count = topology.EdgesCount();
+		topology.incidenceBegin.assign(static_cast<size_t>(edges_count) + 1, 0);
+		for (int32_t e : topology.triangleEdges) {
+			topology.incidenceBegin[e + 1]++;
+		}
+		for (int e = 0; e < edges_count; e++) {
+			topology.incidenceBegin[e + 1] += topology.incidenceBegin[e];
+		}
+		topology.incidenceTriangles.resize(topology.triangleEdges.size());
+		std::vector<int32_t> incidence_fill(topology.incidenceBegin.begin(), topology.incidenceBegin.end() - 1);
+		for (int t = 0; t < triangles_count; t++) {
+			for (int j = 0; j < 3; j++) {
+				topology.incidenceTriangles[incidence_fill[topology.TriangleEdge(t, j)]++] = t;
+			}
+		}
+
+		return topology;
+	}
+
+	/*
+		每个顶点周围的扇形数：顶点的三角形之间通过以该顶点为端点的共享边相连，连通的一组为一个扇形
+		流形顶点（包括边界上的顶点）只有一个扇形，多于一个时为非流形顶点（bowtie，几个扇形只在该顶点相接）
+		- 顶点到三角形的邻接为CSR，各线程分段计数并填入，每个顶点的三角形再排序为编号递增（退化三角形中重复的角点只记一次）
+		- 各线程分段处理顶点，在顶点的三角形之间用小的并查集合并，总时间与三角形数成线性（每次查找多一个二分）
+		num_threads为0时使用全部硬件线程，结果与线程数无关
+	*/
+	inline std::vector<int> CountVertexFans(const STLNonManifold::Geometry::IndexMesh& topology, unsigned int num_threads = 1) {
+		const int MIN_PARALLEL_TRIANGLES = 65536;
+		int vertices_count = topology.VerticesCount();
+		int triangles_count = topology.TrianglesCount();
+		num_threads = stl_reader::stl_reader_impl::ResolveNumThreads(num_threads);
+		size_t num_ranges = triangles_count >= MIN_PARALLEL_TRIANGLES ? num_threads : 1;
+
+		// [0, n)的第r段的起点
+		auto range_begin = [&](int n, size_t r) {
+			return static_cast<int>(static_cast<long long>(n) * static_cast<long long>(r) / static_cast<long long>(num_ranges));
+		};
+
+		// 对三角形t的每个不同的角点调用func(v)
+		auto for_each_corner = [&](int t, auto&& func) {
+			int a = topology.TriangleVertex(t, 0), b = topology.TriangleVertex(t, 1), c = topology.TriangleVertex(t, 2);
+			func(a);
+			if (b != a) {
+				func(b);
+			}
+			if (c != a && c != b) {
+				func(c);
+			}
+		};
+
+		// 顶点到三角形的邻接：先计数再填入
+		std::vector<std::atomic<int>> vertex_fill(vertices_count);
+		stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t r) {
+			for (int v = range_begin(vertices_count, r); v < range_begin(vertices_count, r + 1); v++) {
+				vertex_fill[v].store(0, std::memory_order_relaxed);
+			}
+		});
+		stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t r) {
+			for (int t = range_begin(triangles_count, r); t < range_begin(triangles_count, r + 1); t++) {
+				for_each_corner(t, [&](int v) { vertex_fill[v].fetch_add(1, std::memory_order_relaxed); });
+			}
+		});
+
+		std::vector<int32_t> vertex_triangles_begin(static_cast<size_t>(vertices_count) + 1, 0);
+		for (int v = 0; v < vertices_count; v++) {
+			int count = vertex_fill[v].load(std::memory_order_relaxed);
+			vertex_fill[v].store(vertex_triangles_begin[v], std::memory_order_relaxed);
+			vertex_triangles_begin[v + 1] = vertex_triangles_begin[v] + count;
+		}
+
+		std::vector<int32_t> vertex_triangles(vertex_triangles_begin[vertices_count]);
+		stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t r) {
+			for (int t = range_begin(triangles_count, r); t < range_begin(triangles_count, r + 1); t++) {
+				for_each_corner(t, [&](int v) { vertex_triangles[vertex_fill[v].fetch_add(1, std::memory_order_relaxed)] = t; });
+			}
+		});
+
+		// 扇形：顶点v的第i个三角形与共享v的某条边的另一个三角形合并
+		std::vector<int> vertex_fans(vertices_count, 0);
+		stl_reader::stl_reader_impl::RunParallel(num_ranges, [&](size_t r) {
+			std::vector<int> parents;
+			for (int v = range_begin(vertices_count, r); v < range_begin(vertices_count, r + 1); v++) {
+				int32_t* star_begin = vertex_triangles.data() + vertex_triangles_begin[v];
+				int32_t* star_end = vertex_triangles.data() + vertex_triangles_begin[v + 1];
+				if (num_ranges > 1) {
+					std::sort(star_begin, star_end);
+				}
+
+				int star_size = static_cast<int>(star_end - star_begin);
+				parents.resize(star_size);
+				for (int i = 0; i < star_size; i++) {
+					parents[i] = i;
+				}
+				auto find = [&](int i) {
+					while (parents[i] != i) {
+						parents[i] = parents[parents[i]];
+						i = parents[i];
+					}
+					return i;
+				};
+
+				int fans = star_size;
+				for (int i = 0; i < star_size; i++) {
+					int t = star_begin[i];
+					for (int j = 0; j < 3; j++) {
+						int e = topology.TriangleEdge(t, j);
+						if (topology.EdgeStart(e) != v && topology.EdgeEnd(e) != v) {
+							continue;
+						}
+						for (int k = topology.incidenceBegin[e]; k < topology.incidenceBegin[e + 1]; k++) {
+							int u = topology.incidenceTriangles[k];
+							if (u <= t) {
+								continue;
+							}
+							int a = find(i);
+							int b = find(static_cast<int>(std::lower_bound(star_begin, star_end, u) - star_begin));
+							if (a != b) {
+								parents[std::max(a, b)] = std::min(a, b);
+								fans--;
+							}
+						}
+					}
+				}
+				vertex_fans[v] = fans;
+			}
+		});
+
+		return vertex_fans;
+	}
+
+	/*
+		三角形的连通分量：共享边的三角形在无锁并查集中合并，only_manifold_edges时只经过关联两个三角形的边
+		返回每个三角形所在分量的根（分量中最小的三角形编号），结果与线程数无关
+	*/
+	inline std::vector<int> LabelTriangleComponents(const STLNonManifold::Geometry::IndexMesh& topology, bool only_manifold_edges, unsigned int num_threads = 1) {
+		num_threads = stl_reader::stl_reader_impl::ResolveNumThreads(num_threads);
+		int edges_count = topology.EdgesCount();
+		ConcurrentUnionFind union_find(topology.TrianglesCount());
+
+		stl_reader::stl_reader_impl::RunParallel(num_threads, [&](size_t r) {
+			int begin = static_cast<int>(static_cast<long long>(edges_count) * r / num_threads);
+			int end = static_cast<int>(static_cast<long long>(edges_count) * (r + 1) / num_threads);
+			for (int e = begin; e < end; e++) {
+				if (only_manifold_edges && topology.IncidentTrianglesCount(e) != 2) {
+					continue;
+				}
+				for (int k = topology.incidenceBegin[e] + 1; k < topology.incidenceBegin[e + 1]; k++) {
+					union_find.Unite(topology.incidenceTriangles[topology.incidenceBegin[e]], topology.incidenceTriangles[k]);
+				}
+			}
+		});
+
+		return CollectRoots(union_find, num_threads);
+	}
+
+	/*
+		按LabelTriangleComponents的结果分组，分量按最小的三角形编号排序
+		分量c的三角形为triangles[begin[c], begin[c + 1])，按编号递增；componentIds为每个三角形所在的分量
+	*/
+	struct TriangleComponents {
+		std::vector<int> componentIds;
+		std::vector<int> begin;
+		std::vector<int> triangles;
+
+		TriangleComponents() : begin(1, 0) {}
+
+		explicit TriangleComponents(const std::vector<int>& roots) : componentIds(roots.size(), -1), begin(1, 0), triangles(roots.size()) {
+			int triangles_count = static_cast<int>(roots.size());
+			for (int t = 0; t < triangles_count; t++) {
+				if (roots[t] == t) {
+					componentIds[t] = static_cast<int>(begin.size()) - 1;
+					begin.push_back(0);
+				}
+				componentIds[t] = componentIds[roots[t]];
+				begin[componentIds[t] + 1]++;
+			}
+			for (int c = 0; c < Count(); c++) {
+				begin[c + 1] += begin[c];
+			}
+			std::vector<int> fill(begin.begin(), begin.end() - 1);
+			for (int t = 0; t < triangles_count; t++) {
+				triangles[fill[componentIds[t]]++] = t;
+			}
+		}
+
+		int Count() const {
+			return static_cast<int>(begin.size()) - 1;
+		}
+
+		int TrianglesCount(int c) const {
+			return begin[c + 1] - begin[c];
+		}
+	};
+
+	/*
+		边e是否方向不一致：关联两个（不同的）三角形，且两个三角形沿相同方向经过它（相邻三角形的法向相反）
+	*/
+	inline bool IsInconsistentEdge(const STLNonManifold::Geometry::IndexMesh& topology, int e) {
+		if (topology.IncidentTrianglesCount(e) != 2) {
+			return false;
+		}
+		int t0 = topology.incidenceTriangles[topology.incidenceBegin[e]];
+		int t1 = topology.incidenceTriangles[topology.incidenceBegin[e] + 1];
+		return t0 != t1 && topology.EdgeSense(t0, topology.EdgeIndexInTriangle(t0, e)) == topology.EdgeSense(t1, topology.EdgeIndexInTriangle(t1, e));
+	}
+
+	/*
+		方向不一致的边（IsInconsistentEdge）：按边编号递增对每条这样的边调用visitor(e, t0, t1)
+	*/
+	template<typename Visitor>
+	void ForEachInconsistentEdge(const STLNonManifold::Geometry::IndexMesh& topology, Visitor&& visitor) {
+		for (int e = 0; e < topology.EdgesCount(); e++) {
+			if (IsInconsistentEdge(topology, e)) {
+				visitor(e, topology.incidenceTriangles[topology.incidenceBegin[e]], topology.incidenceTriangles[topology.incidenceBegin[e] + 1]);
+			}
+		}
+	}
+
+	/*
+		按连通分量统一三角形的方向，返回反转的三角形数：
+		- 分量只经过关联两个三角形的边（LabelTriangleComponents），非流形边两侧的方向互不影响
+		- 每个分量从编号最小的三角形开始广度优先遍历，使相邻的三角形沿相反方向经过共享边，各线程依次领取分量
+		- 每个分量反转较少的一侧（相同时保持起点三角形的方向）
+		不可定向的分量（如莫比乌斯带）遍历后仍有方向不一致的边；结果与线程数无关
+	*/
+	inline int ReorientTriangles(STLNonManifold::Geometry::IndexMesh& topology, unsigned int num_threads = 1) {
+		num_threads = stl_reader::stl_reader_impl::ResolveNumThreads(num_threads);
+		int triangles_count = topology.TrianglesCount();
+		TriangleComponents components(LabelTriangleComponents(topology, true, num_threads));
+		int components_count = components.Count();
+
+		// 每个三角形是否反转，-1为未访问
+		std::vector<int8_t> flips(triangles_count, -1);
+		std::atomic<int> next_component(0);
+		stl_reader::stl_reader_impl::RunParallel(num_threads, [&](size_t) {
+			std::vector<int> queue;
+			for (int c = next_component.fetch_add(1); c < components_count; c = next_component.fetch_add(1)) {
+				int seed = components.triangles[components.begin[c]];
+				queue.clear();
+				queue.push_back(seed);
+				flips[seed] = 0;
+
+				int flipped_count = 0;
+				for (size_t q = 0; q < queue.size(); q++) {
+					int t = queue[q];
+					for (int j = 0; j < 3; j++) {
+						int e = topology.TriangleEdge(t, j);
+						if (topology.IncidentTrianglesCount(e) != 2) {
+							continue;
+						}
+						int u = topology.incidenceTriangles[topology.incidenceBegin[e]];
+						if (u == t) {
+							u = topology.incidenceTriangles[topology.incidenceBegin[e] + 1];
+						}
+						if (u == t || flips[u] >= 0) {
+							continue;
+						}
+
+						// 沿相同方向经过共享边时，u与t的反转相反
+						bool same_direction = topology.EdgeSense(t, j) == topology.EdgeSense(u, topology.EdgeIndexInTriangle(u, e));
+						flips[u] = static_cast<int8_t>(flips[t] ^ (same_direction ? 1 : 0));
+						flipped_count += flips[u];
+						queue.push_back(u);
+					}
+				}
+
+				if (static_cast<size_t>(flipped_count) * 2 > queue.size()) {
+					for (int t : queue) {
+						flips[t] ^= 1;
+					}
+				}
+			}
+		});
+
+		std::vector<int> range_flipped(num_threads, 0);
+		stl_reader::stl_reader_impl::RunParallel(num_threads, [&](size_t r) {
+			int begin = static_cast<int>(static_cast<long long>(triangles_count) * r / num_threads);
+			int end = static_cast<int>(static_cast<long long>(triangles_count) * (r + 1) / num_threads);
+			for (int t = begin; t < end; t++) {
+				if (flips[t] == 1) {
+					topology.FlipTriangle(t);
+					range_flipped[r]++;
+				}
+			}
+		});
+
+		int flipped_count = 0;
+		for (int count : range_flipped) {
+			flipped_count += count;
+		}
+		return flipped_count;
+	}
 
-					int p1_index = i + j;
-					int p2_index = i + (j+1)%3;
-					int p1_merged_index = coordinates_indices[p1_index];
-					int p2_merged_index = coordinates_indices[p2_index];
+	/*
+		壳：通过共享边（包括非流形边）连接的三角形，装配体中的每个零件通常是一个壳
+	*/
+	struct ShellInfo {
+		int trianglesCount = 0;
+		int edgesCount = 0;
+		int verticesCount = 0;
+		STLNonManifold::Geometry::T_NUM minCoord[3] = {};
+		STLNonManifold::Geometry::T_NUM maxCoord[3] = {};
+		int nonManifoldCount = 0; // 计数方式与CheckNonManifold相同，各壳之和等于总数
+		int nonManifoldVerticesCount = 0; // 几个壳只在一个非流形顶点相接时，每个壳都计数
+		int inconsistentEdgesCount = 0;
+
+		bool HasDefects() const {
+			return nonManifoldCount > 0 || nonManifoldVerticesCount > 0 || inconsistentEdgesCount > 0;
+		}
+	};
 
-					int start_merged_index = p1_merged_index;
-					int end_merged_index = p2_merged_index;
+	/*
+		壳s中按编号递增的顶点与边（去重）
+	*/
+	inline void CollectShellElements(const STLNonManifold::Geometry::IndexMesh& topology, const TriangleComponents& shells, int s, std::vector<int>& vertices, std::vector<int>& edges) {
+		vertices.clear();
+		edges.clear();
+		for (int i = shells.begin[s]; i < shells.begin[s + 1]; i++) {
+			int t = shells.triangles[i];
+			for (int j = 0; j < 3; j++) {
+				vertices.push_back(topology.TriangleVertex(t, j));
+				edges.push_back(topology.TriangleEdge(t, j));
+			}
+		}
+		std::sort(vertices.begin(), vertices.end());
+		vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+		std::sort(edges.begin(), edges.end());
+		edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+	}
 
-					if (p1_merged_index > p2_merged_index) {
-						std::swap(p1_merged_index, p2_merged_index);
+	/*
+		统计每个壳的三角形数、包围盒与缺陷数，shells为LabelTriangleComponents(topology, false)的分组，
+		vertex_fans为CountVertexFans的结果；各线程依次领取壳
+	*/
+	inline std::vector<ShellInfo> CollectShells(const STLNonManifold::Geometry::IndexMesh& topology, const std::vector<int>& vertex_fans, const TriangleComponents& shells, unsigned int num_threads = 1) {
+		num_threads = stl_reader::stl_reader_impl::ResolveNumThreads(num_threads);
+		std::vector<ShellInfo> infos(shells.Count());
+
+		std::atomic<int> next_shell(0);
+		stl_reader::stl_reader_impl::RunParallel(num_threads, [&](size_t) {
+			std::vector<int> vertices, edges;
+			for (int s = next_shell.fetch_add(1); s < shells.Count(); s = next_shell.fetch_add(1)) {
+				ShellInfo& info = infos[s];
+				info.trianglesCount = shells.TrianglesCount(s);
+
+				CollectShellElements(topology, shells, s, vertices, edges);
+				info.verticesCount = static_cast<int>(vertices.size());
+				info.edgesCount = static_cast<int>(edges.size());
+
+				const STLNonManifold::Geometry::T_NUM* first_coord = topology.VertexCoord(vertices[0]);
+				std::copy(first_coord, first_coord + 3, info.minCoord);
+				std::copy(first_coord, first_coord + 3, info.maxCoord);
+				for (int v : vertices) {
+					const STLNonManifold::Geometry::T_NUM* coord = topology.VertexCoord(v);
+					for (int i = 0; i < 3; i++) {
+						info.minCoord[i] = std::min(info.minCoord[i], coord[i]);
+						info.maxCoord[i] = std::max(info.maxCoord[i], coord[i]);
+					}
+					if (vertex_fans[v] > 1) {
+						info.nonManifoldVerticesCount++;
+					}
+				}
+
+				for (int i = shells.begin[s]; i < shells.begin[s + 1]; i++) {
+					int t = shells.triangles[i];
+					for (int j = 0; j < 3; j++) {
+						int e = topology.TriangleEdge(t, j);
+						if (topology.IncidentTrianglesCount(e) != 2) {
+							info.nonManifoldCount++;
+						}
+						// 方向不一致的边只在编号较小的三角形处计数
+						else if (topology.incidenceTriangles[topology.incidenceBegin[e]] == t && IsInconsistentEdge(topology, e)) {
+							info.inconsistentEdgesCount++;
+						}
+					}
+				}
+			}
+		});
+
+		return infos;
+	}
+
+	/*
+		自相交检查：不共享顶点的两个三角形相交（包括接触）
+		- 共享顶点（包括共享边）的三角形对跳过，相邻三角形总是在公共顶点处接触
+		- 退化的三角形（角点重合或三点共线）不参与检查
+		- 相交判断见Intersection::TrianglesIntersect，坐标转为double
+	*/
+	struct SelfIntersectionTester {
+		SelfIntersectionTester(const STLNonManifold::Geometry::IndexMesh& mesh, unsigned int num_threads = 1) : topology(mesh) {
+			num_threads = stl_reader::stl_reader_impl::ResolveNumThreads(num_threads);
+			int triangles_count = topology.TrianglesCount();
+			triangleVertices.resize(static_cast<size_t>(triangles_count) * 3);
+			degenerate.resize(triangles_count);
+
+			stl_reader::stl_reader_impl::RunParallel(num_threads, [&](size_t r) {
+				int begin = static_cast<int>(static_cast<long long>(triangles_count) * r / num_threads);
+				int end = static_cast<int>(static_cast<long long>(triangles_count) * (r + 1) / num_threads);
+				for (int t = begin; t < end; t++) {
+					int32_t* corners = &triangleVertices[static_cast<size_t>(t) * 3];
+					for (int j = 0; j < 3; j++) {
+						corners[j] = topology.TriangleVertex(t, j);
+					}
+
+					double p[3][3];
+					LoadTriangle(t, p);
+					double u[3], v[3];
+					for (int i = 0; i < 3; i++) {
+						u[i] = p[1][i] - p[0][i];
+						v[i] = p[2][i] - p[0][i];
+					}
+					bool collinear = u[1] * v[2] - u[2] * v[1] == 0.0 && u[2] * v[0] - u[0] * v[2] == 0.0 && u[0] * v[1] - u[1] * v[0] == 0.0;
+					degenerate[t] = corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0] || collinear;
+				}
+			});
+		}
+
+		void LoadTriangle(int t, double p[3][3]) const {
+			for (int j = 0; j < 3; j++) {
+				const STLNonManifold::Geometry::T_NUM* coord = topology.VertexCoord(triangleVertices[static_cast<size_t>(t) * 3 + j]);
+				for (int i = 0; i < 3; i++) {
+					p[j][i] = static_cast<double>(coord[i]);
+				}
+			}
+		}
+
+		bool Intersects(int a, int b) const {
+			if (degenerate[a] || degenerate[b]) {
+				return false;
+			}
+			const int32_t* corners_a = &triangleVertices[static_cast<size_t>(a) * 3];
+			const int32_t* corners_b = &triangleVertices[static_cast<size_t>(b) * 3];
+			for (int i = 0; i < 3; i++) {
+				for (int j = 0; j < 3; j++) {
+					if (corners_a[i] == corners_b[j]) {
+						return false;
 					}
+				}
+			}
+
+			double p[3][3], q[3][3];
+			LoadTriangle(a, p);
+			LoadTriangle(b, q);
+			const double* p_corners[3] = { p[0], p[1], p[2] };
+			const double* q_corners[3] = { q[0], q[1], q[2] };
+			return Intersection::TrianglesIntersect(p_corners, q_corners);
+		}
+
+		const STLNonManifold::Geometry::IndexMesh& topology;
+		std::vector<int32_t> triangleVertices; // 三角形t的角点为triangleVertices[3t, 3t + 3)
+		std::vector<uint8_t> degenerate;
+	};
+
+	/*
+		找出自相交的三角形对，按(较小编号, 较大编号)排序，结果与线程数无关
+		在TriangleBVH中找出包围盒相交的三角形对，各线程分别检查后合并
+	*/
+	inline std::vector<std::pair<int, int>> FindSelfIntersections(const STLNonManifold::Geometry::IndexMesh& topology, unsigned int num_threads = 1) {
+		num_threads = stl_reader::stl_reader_impl::ResolveNumThreads(num_threads);
+		SelfIntersectionTester tester(topology, num_threads);
+		TriangleBVH bvh(topology.vertexCoords.data(), tester.triangleVertices, num_threads);
+
+		std::vector<std::vector<std::pair<int, int>>> thread_pairs(num_threads);
+		bvh.ForEachOverlappingPair([&](size_t r, int a, int b) {
+			if (tester.Intersects(a, b)) {
+				thread_pairs[r].emplace_back(std::min(a, b), std::max(a, b));
+			}
+		}, num_threads);
+
+		std::vector<std::pair<int, int>> pairs;
+		for (auto&& local_pairs : thread_pairs) {
+			pairs.insert(pairs.end(), local_pairs.begin(), local_pairs.end());
+		}
+		std::sort(pairs.begin(), pairs.end());
+		return pairs;
+	}
 
-					auto it = edges_map.find(std::make_pair(p1_merged_index, p2_merged_index));
-					if (it == edges_map.end()) {
-						// Ӧϲģ߲ڣ
-						auto edge_ptr = std::make_shared<STLNonManifold::Geometry::Edge>();
+	/*
+		原来的拓扑：Vertex、Edge、Triangle由shared_ptr互相连接，保留作为IndexMesh的参照（benchmark topology）
+	*/
+	struct TopologyGraph {
+		std::vector<std::shared_ptr<STLNonManifold::Geometry::Triangle>> triangles;
+		int verticesCount = 0;
+		int edgesCount = 0;
 
-						edge_ptr->start = vertices_map[start_merged_index];
-						edge_ptr->end = vertices_map[end_merged_index];
-						edge_ptr->incident_triangles.emplace_back(triangle_ptr);
-						edge_ptr->id = edges_count++;
+		TopologyGraph() = default;
+		TopologyGraph(const TopologyGraph&) = delete;
+		TopologyGraph& operator=(const TopologyGraph&) = delete;
+		TopologyGraph(TopologyGraph&&) = default;
 
-						triangle_ptr->edges.emplace_back(edge_ptr);
-						triangle_ptr->edges_senses.emplace_back(true);
+		~TopologyGraph() {
+			// 三角形与边互相引用，先断开才能释放
+			for (auto&& triangle_ptr : triangles) {
+				for (auto&& edge_ptr : triangle_ptr->edges) {
+					edge_ptr->incident_triangles.clear();
+				}
+			}
+		}
 
-						edges_map[std::make_pair(p1_merged_index, p2_merged_index)] = edge_ptr;
+		/*
+			估计占用的内存（字节）：对象、make_shared的控制块（按16字节计）与vector的容量，不含分配器的额外开销
+		*/
+		size_t MemoryBytes() const {
+			const size_t CONTROL_BLOCK_BYTES = 16;
+			size_t bytes = triangles.capacity() * sizeof(std::shared_ptr<STLNonManifold::Geometry::Triangle>);
+			std::vector<bool> edge_counted(edgesCount, false);
+			std::vector<bool> vertex_counted(verticesCount, false);
+			for (auto&& triangle_ptr : triangles) {
+				bytes += CONTROL_BLOCK_BYTES + sizeof(STLNonManifold::Geometry::Triangle);
+				bytes += triangle_ptr->edges.capacity() * sizeof(std::shared_ptr<STLNonManifold::Geometry::Edge>) + (triangle_ptr->edges_senses.capacity() + 7) / 8;
+				for (auto&& edge_ptr : triangle_ptr->edges) {
+					if (edge_counted[edge_ptr->id]) {
+						continue;
 					}
-					else {
-						// ӦѾڣά
-						auto edge_ptr = it->second;
-						edge_ptr->incident_triangles.emplace_back(triangle_ptr);
-						triangle_ptr->edges.emplace_back(edge_ptr);
-						triangle_ptr->edges_senses.emplace_back(false);
+					edge_counted[edge_ptr->id] = true;
+					bytes += CONTROL_BLOCK_BYTES + sizeof(STLNonManifold::Geometry::Edge) + edge_ptr->incident_triangles.capacity() * sizeof(std::shared_ptr<STLNonManifold::Geometry::Triangle>);
+					for (auto&& vertex_ptr : { edge_ptr->start, edge_ptr->end }) {
+						if (!vertex_counted[vertex_ptr->id]) {
+							vertex_counted[vertex_ptr->id] = true;
+							bytes += 2 * CONTROL_BLOCK_BYTES + sizeof(STLNonManifold::Geometry::Vertex) + sizeof(STLNonManifold::Geometry::Coordinate);
+						}
 					}
+				}
+			}
+			return bytes;
+		}
+	};
 
+	inline TopologyGraph BuildTopologyGraph(const std::vector<STLNonManifold::Geometry::Coordinate>& coordinates, const std::vector<int>& coordinates_indices, const std::vector<int>& vertex_order) {
+		TopologyGraph graph;
+		int coords_count = static_cast<int>(coordinates.size());
+
+		// 构造拓扑：构造顶点
+		// 注意这里vertex的id是按照坐标合并后新赋值的
+		int vertices_count = 0;
+		std::map<int, std::shared_ptr<STLNonManifold::Geometry::Vertex>> vertices_map; // merged_index -> vertex
+		for (int vertex_merged_index : vertex_order) {
+			auto it = vertices_map.find(vertex_merged_index);
+
+			// 没找到已经创建的顶点：创建
+			if (it == vertices_map.end()) {
+
+				auto vertex_ptr = std::make_shared<STLNonManifold::Geometry::Vertex>();
+				auto coord_ptr = std::make_shared<STLNonManifold::Geometry::Coordinate>(coordinates[vertex_merged_index]); // 复制
+
+				// 构造顶点
+				vertex_ptr->id = vertices_count;
+				vertex_ptr->pointCoord = coord_ptr;
+				coord_ptr->id = vertices_count;
+
+				vertices_map[vertex_merged_index] = vertex_ptr;
+				vertices_count++;
+			}
+		}
+
+		// 构造拓扑：逐三角形地去构造
+		int edges_count = 0;
+		int triangles_count = 0;
+		std::map<std::pair<int, int>, std::shared_ptr<STLNonManifold::Geometry::Edge>> edges_map; // (merge_index, merged_index) -> edge
+		for (int i = 0; i< coords_count; i += 3) {
+			// 三角
+			std::shared_ptr<STLNonManifold::Geometry::Triangle> triangle_ptr = std::make_shared<STLNonManifold::Geometry::Triangle>();
+			triangle_ptr->id = i/3;
+
+			// 边
+			for (int j = 0; j < 3; j++) {
+
+				int p1_index = i + j;
+				int p2_index = i + (j+1)%3;
+				int p1_merged_index = coordinates_indices[p1_index];
+				int p2_merged_index = coordinates_indices[p2_index];
+
+				int start_merged_index = p1_merged_index;
+				int end_merged_index = p2_merged_index;
+
+				if (p1_merged_index > p2_merged_index) {
+					std::swap(p1_merged_index, p2_merged_index);
 				}
 
-				triangles.emplace_back(triangle_ptr);
-				triangles_count++;
+				auto it = edges_map.find(std::make_pair(p1_merged_index, p2_merged_index));
+				if (it == edges_map.end()) {
+					// 对应（合并顶点后的）边不存在：创建
+					auto edge_ptr = std::make_shared<STLNonManifold::Geometry::Edge>();
+
+					edge_ptr->start = vertices_map[start_merged_index];
+					edge_ptr->end = vertices_map[end_merged_index];
+					edge_ptr->incident_triangles.emplace_back(triangle_ptr);
+					edge_ptr->id = edges_count++;
+
+					triangle_ptr->edges.emplace_back(edge_ptr);
+					triangle_ptr->edges_senses.emplace_back(true);
+
+					edges_map[std::make_pair(p1_merged_index, p2_merged_index)] = edge_ptr;
+				}
+				else {
+					// 对应边已经存在：维护
+					auto edge_ptr = it->second;
+					edge_ptr->incident_triangles.emplace_back(triangle_ptr);
+					triangle_ptr->edges.emplace_back(edge_ptr);
+					triangle_ptr->edges_senses.emplace_back(false);
+				}
+
+			}
+
+			graph.triangles.emplace_back(triangle_ptr);
+			triangles_count++;
+		}
+
+		graph.verticesCount = vertices_count;
+		graph.edgesCount = edges_count;
+		return graph;
+	}
+
+	struct STLNonManifoldChecker {
+
+		STLNonManifoldChecker(const std::string& stl_file, const CheckerOptions& checker_options = CheckerOptions()): options(checker_options) {
+
+			// 读取所有坐标
+			auto load_start = std::chrono::steady_clock::now();
+			std::vector<STLNonManifold::Geometry::Coordinate> coordinates;
+			if (options.mappedBinaryReader && !stl_reader::StlFileIsGzip(stl_file.c_str()) && !stl_reader::StlFileHasASCIIFormat(stl_file.c_str())) {
+				StlBinaryViewType view(stl_file);
+				coordinates = CollectCoordinates(view);
+			}
+			else {
+				// 不做精确去重（RemoveDoubles的排序），顶点只由下面的KDTree合并一次
+				mesh.read_file_soup(stl_file, options.numThreads);
+				coordinates = CollectCoordinates(mesh);
 			}
+			loadTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load_start).count();
+			LOG_INFO("loadTime: %.3lf ms", loadTimeMs);
+			
+			BuildTopology(coordinates);
+		}
+
+		/*
+			直接由角点坐标构造，每3个坐标为一个三角形，coordinates[i]的id必须为i
+		*/
+		STLNonManifoldChecker(const std::vector<STLNonManifold::Geometry::Coordinate>& coordinates, const CheckerOptions& checker_options = CheckerOptions()) : options(checker_options) {
+			BuildTopology(coordinates);
+		}
+
+		/*
+			合并坐标并构造拓扑
+		*/
+		void BuildTopology(const std::vector<STLNonManifold::Geometry::Coordinate>& coordinates) {
+			std::vector<int> vertex_order;
+			std::vector<int> coordinates_indices = WeldCoordinatesForTopology(coordinates, options, vertex_order);
+			topology = BuildIndexMesh(coordinates, coordinates_indices, vertex_order, options.numThreads);
+			vertexFans = CountVertexFans(topology, options.numThreads);
 
-			verticesCount = vertices_count;
-			edgesCount = edges_count;
-			trianglesCount = triangles_count;
+			verticesCount = topology.VerticesCount();
+			edgesCount = topology.EdgesCount();
+			trianglesCount = topology.TrianglesCount();
 
 			//std::cout << "verticesCount: " << verticesCount << std::endl;
 			//std::cout << "edgesCount: " << edgesCount << std::endl;
@@ -270,34 +1433,41 @@ namespace STLNonManifold {
 			LOG_INFO("trianglesCount: %d", trianglesCount);
 		}
 
-		void CheckNonManifold() {
-
+		/*
+			只统计非流形（关联三角形数不为2的边）的个数，不输出，计数方式与CheckNonManifold相同
+		*/
+		int CountNonManifold() const {
 			int non_manifold_count = 0;
+			for (int32_t e : topology.triangleEdges) {
+				if (topology.IncidentTrianglesCount(e) != 2) {
+					non_manifold_count++;
+				}
+			}
+			return non_manifold_count;
+		}
 
-			for (auto&& triangle_ptr : triangles) {
-				//std::cout << "Triangle: " << triangle_ptr->id << std::endl;
+		int CheckNonManifold() {
 
-				for (auto&& edge_ptr : triangle_ptr->edges) {
-					//std::cout << "Edge: " << edge_ptr->id << std::endl;
+			int non_manifold_count = 0;
 
-					if (edge_ptr->incident_triangles.size() != 2) {
+			for (int t = 0; t < trianglesCount; t++) {
+				for (int j = 0; j < 3; j++) {
+					int e = topology.TriangleEdge(t, j);
+
+					if (topology.IncidentTrianglesCount(e) != 2) {
 						non_manifold_count++;
-						//std::cout << "======" << std::endl;
-						//std::cout << "NonManifold: " << edge_ptr->incident_triangles.size() << std::endl;
-						//std::cout << "Triangle: " << triangle_ptr->id << std::endl;
-						//std::cout << "Edge: " << edge_ptr->id << std::endl;
-						//std::cout << "Start Vertex: " << edge_ptr->start->id << std::endl;
-						//std::cout << "(" << edge_ptr->start->pointCoord->x() <<", " << edge_ptr->start->pointCoord->y() << ", "<< edge_ptr->start->pointCoord->z() <<")" << std::endl;
-						//std::cout << "End Vertex: " << edge_ptr->end->id << std::endl;
-						//std::cout << "(" << edge_ptr->end->pointCoord->x() << ", " << edge_ptr->end->pointCoord->y() << ", " << edge_ptr->end->pointCoord->z() << ")" << std::endl;
-						//std::cout << "======" << std::endl;
+
+						int start = topology.EdgeStart(e);
+						int end = topology.EdgeEnd(e);
+						const STLNonManifold::Geometry::T_NUM* start_coord = topology.VertexCoord(start);
+						const STLNonManifold::Geometry::T_NUM* end_coord = topology.VertexCoord(end);
 
 						LOG_INFO("======");
-						LOG_INFO("NonManifold: %d", edge_ptr->incident_triangles.size());
-						LOG_INFO("Triangle: %d", triangle_ptr->id);
-						LOG_INFO("Edge: %d", edge_ptr->id);
-						LOG_INFO("Start Vertex: %d (%.5lf, %.5lf, %.5lf)", edge_ptr->start->id, edge_ptr->start->pointCoord->x(), edge_ptr->start->pointCoord->y(), edge_ptr->start->pointCoord->z());
-						LOG_INFO("End Vertex: %d (%.5lf, %.5lf, %.5lf)", edge_ptr->end->id, edge_ptr->end->pointCoord->x(), edge_ptr->end->pointCoord->y(), edge_ptr->end->pointCoord->z());
+						LOG_INFO("NonManifold: %d", topology.IncidentTrianglesCount(e));
+						LOG_INFO("Triangle: %d", t);
+						LOG_INFO("Edge: %d", e);
+						LOG_INFO("Start Vertex: %d (%.5lf, %.5lf, %.5lf)", start, start_coord[0], start_coord[1], start_coord[2]);
+						LOG_INFO("End Vertex: %d (%.5lf, %.5lf, %.5lf)", end, end_coord[0], end_coord[1], end_coord[2]);
 						LOG_INFO("======");
 
 					}
@@ -310,69 +1480,284 @@ namespace STLNonManifold {
 			LOG_INFO("Total NonManifold Count: %d", non_manifold_count);
 			LOG_INFO("CheckNonManifold end.");
 
+			return non_manifold_count;
 		}
-		
-		void Export2OBJ(const std::string& output_obj_file_path) {
-			// vertexеidʵͿԱΪɢĸ㣬˿ֱӸΪ
-			std::fstream f;
-			f.open(output_obj_file_path, std::ios::out | std::ios::trunc);
 
-			if (!f.is_open()) {
-				throw std::runtime_error("Open output_obj_file_path failed.");
+		/*
+			只统计非流形顶点（扇形数多于1）的个数，不输出
+		*/
+		int CountNonManifoldVertices() const {
+			return static_cast<int>(std::count_if(vertexFans.begin(), vertexFans.end(), [](int fans) { return fans > 1; }));
+		}
+
+		/*
+			输出非流形顶点（bowtie）：顶点周围的三角形只在该顶点相接，通过共享边连成多于一个扇形
+		*/
+		int CheckNonManifoldVertices() const {
+			int non_manifold_vertices_count = 0;
+
+			for (int v = 0; v < verticesCount; v++) {
+				if (vertexFans[v] > 1) {
+					non_manifold_vertices_count++;
+
+					const STLNonManifold::Geometry::T_NUM* coord = topology.VertexCoord(v);
+					LOG_INFO("======");
+					LOG_INFO("NonManifold Vertex: %d (%.5lf, %.5lf, %.5lf)", v, coord[0], coord[1], coord[2]);
+					LOG_INFO("Fans: %d", vertexFans[v]);
+					LOG_INFO("======");
+				}
 			}
 
-			f << "# verticesCount: " << verticesCount << "\n";
-			f << "# edgesCount: " << edgesCount << "\n";
-			f << "# trianglesCount: " << trianglesCount << "\n";
+			std::cout << "Total NonManifold Vertex Count: " << non_manifold_vertices_count << std::endl;
+			LOG_INFO("Total NonManifold Vertex Count: %d", non_manifold_vertices_count);
 
-			// v
-			// οʼȡÿ㣨ȻҪȥأ
-			std::vector<std::shared_ptr<STLNonManifold::Geometry::Vertex>> vertices;
-			std::unordered_set<int> vertices_id_set;
-			for (auto&& triangle_ptr : triangles) {
-				for (auto&& edge_ptr : triangle_ptr->edges) {
-					int vertices_id = edge_ptr->start->id;
-					
-					if (vertices_id_set.count(vertices_id) == 0) {
-						vertices.emplace_back(edge_ptr->start);
-						vertices_id_set.insert(vertices_id);
-					}
+			return non_manifold_vertices_count;
+		}
 
-					vertices_id = edge_ptr->end->id;
-					if (vertices_id_set.count(vertices_id) == 0) {
-						vertices.emplace_back(edge_ptr->end);
-						vertices_id_set.insert(vertices_id);
-					}
+		/*
+			只统计方向不一致的边（两个相邻三角形沿相同方向经过）的个数，不输出
+		*/
+		int CountInconsistentEdges() const {
+			int inconsistent_count = 0;
+			ForEachInconsistentEdge(topology, [&](int, int, int) {
+				inconsistent_count++;
+			});
+			return inconsistent_count;
+		}
+
+		/*
+			输出方向不一致的边：关联两个三角形，且两个三角形的法向在该边两侧相反
+		*/
+		int CheckOrientation() const {
+			int inconsistent_count = 0;
+
+			ForEachInconsistentEdge(topology, [&](int e, int t0, int t1) {
+				inconsistent_count++;
+
+				int start = topology.EdgeStart(e);
+				int end = topology.EdgeEnd(e);
+				const STLNonManifold::Geometry::T_NUM* start_coord = topology.VertexCoord(start);
+				const STLNonManifold::Geometry::T_NUM* end_coord = topology.VertexCoord(end);
+
+				LOG_INFO("======");
+				LOG_INFO("Inconsistent Orientation Edge: %d", e);
+				LOG_INFO("Triangles: %d %d", t0, t1);
+				LOG_INFO("Start Vertex: %d (%.5lf, %.5lf, %.5lf)", start, start_coord[0], start_coord[1], start_coord[2]);
+				LOG_INFO("End Vertex: %d (%.5lf, %.5lf, %.5lf)", end, end_coord[0], end_coord[1], end_coord[2]);
+				LOG_INFO("======");
+			});
+
+			std::cout << "Total Inconsistent Orientation Count: " << inconsistent_count << std::endl;
+			LOG_INFO("Total Inconsistent Orientation Count: %d", inconsistent_count);
+
+			return inconsistent_count;
+		}
+
+		/*
+			按连通分量统一三角形的方向（ReorientTriangles），之后的Export2OBJ输出反转后的面
+			返回反转的三角形数；不可定向的分量仍会留下方向不一致的边
+		*/
+		int Reorient() {
+			int flipped_count = ReorientTriangles(topology, options.numThreads);
+			int remaining_count = CountInconsistentEdges();
+
+			std::cout << "Reoriented Triangles: " << flipped_count << std::endl;
+			std::cout << "Remaining Inconsistent Orientation Count: " << remaining_count << std::endl;
+			LOG_INFO("Reoriented Triangles: %d", flipped_count);
+			LOG_INFO("Remaining Inconsistent Orientation Count: %d", remaining_count);
+
+			return flipped_count;
+		}
+
+		/*
+			标记壳（共享边连接的三角形，LabelTriangleComponents）并统计每个壳，结果保存在shellComponents与shells中
+		*/
+		int LabelShells() {
+			shellComponents = TriangleComponents(LabelTriangleComponents(topology, false, options.numThreads));
+			shells = CollectShells(topology, vertexFans, shellComponents, options.numThreads);
+			return static_cast<int>(shells.size());
+		}
+
+		/*
+			输出每个壳的三角形数、包围盒与缺陷数，壳按最小的三角形编号排序
+		*/
+		int CheckShells() {
+			LabelShells();
+
+			int defective_count = 0;
+			for (int s = 0; s < static_cast<int>(shells.size()); s++) {
+				const ShellInfo& info = shells[s];
+				if (info.HasDefects()) {
+					defective_count++;
 				}
+
+				LOG_INFO("======");
+				LOG_INFO("Shell: %d", s);
+				LOG_INFO("Triangles: %d", info.trianglesCount);
+				LOG_INFO("Bounding Box: (%.5lf, %.5lf, %.5lf) (%.5lf, %.5lf, %.5lf)", info.minCoord[0], info.minCoord[1], info.minCoord[2], info.maxCoord[0], info.maxCoord[1], info.maxCoord[2]);
+				LOG_INFO("NonManifold: %d", info.nonManifoldCount);
+				LOG_INFO("NonManifold Vertex: %d", info.nonManifoldVerticesCount);
+				LOG_INFO("Inconsistent Orientation: %d", info.inconsistentEdgesCount);
+				LOG_INFO("======");
 			}
 
-			std::sort(vertices.begin(), vertices.end(), [](const std::shared_ptr<STLNonManifold::Geometry::Vertex>& a, const std::shared_ptr<STLNonManifold::Geometry::Vertex>& b) {
-				return a->id < b->id;
-			});
+			std::cout << "Total Shell Count: " << shells.size() << std::endl;
+			std::cout << "Shells With Defects: " << defective_count << std::endl;
+			LOG_INFO("Total Shell Count: %d", static_cast<int>(shells.size()));
+			LOG_INFO("Shells With Defects: %d", defective_count);
+
+			return static_cast<int>(shells.size());
+		}
+
+		/*
+			输出自相交（不共享顶点却相交）的三角形对（FindSelfIntersections）
+		*/
+		int CheckSelfIntersections() const {
+			std::vector<std::pair<int, int>> pairs = FindSelfIntersections(topology, options.numThreads);
+
+			for (auto&& pair : pairs) {
+				LOG_INFO("======");
+				LOG_INFO("Self Intersection: %d %d", pair.first, pair.second);
+				for (int t : { pair.first, pair.second }) {
+					LOG_INFO("Triangle: %d (%d, %d, %d)", t, topology.TriangleVertex(t, 0), topology.TriangleVertex(t, 1), topology.TriangleVertex(t, 2));
+				}
+				LOG_INFO("======");
+			}
 
-			for (auto&& v_ptr : vertices) {
-				f << "v " << v_ptr->pointCoord->x() << " " << v_ptr->pointCoord->y() << " " << v_ptr->pointCoord->z() << "\n";
+			std::cout << "Total Self Intersection Count: " << pairs.size() << std::endl;
+			LOG_INFO("Total Self Intersection Count: %d", static_cast<int>(pairs.size()));
+
+			return static_cast<int>(pairs.size());
+		}
+		
+		/*
+			导出OBJ：顶点按id顺序输出，面按三角形顺序输出
+			通过ObjWriter格式化并整块写出；float_format为GENERAL_6时与Export2OBJ_Stream的输出逐字节相同
+		*/
+		void Export2OBJ(const std::string& output_obj_file_path, ObjFloatFormat float_format = ObjFloatFormat::GENERAL_6) {
+			ObjWriter writer(output_obj_file_path, float_format);
+
+			writer.WriteText("# verticesCount: ");
+			writer.WriteInt(verticesCount);
+			writer.WriteText("\n# edgesCount: ");
+			writer.WriteInt(edgesCount);
+			writer.WriteText("\n# trianglesCount: ");
+			writer.WriteInt(trianglesCount);
+			writer.WriteText("\n");
+
+			// v
+			// 每个顶点都是某个三角形的角点，按id顺序全部输出
+			for (int v = 0; v < verticesCount; v++) {
+				const STLNonManifold::Geometry::T_NUM* coord = topology.VertexCoord(v);
+				writer.WriteVertex(coord[0], coord[1], coord[2]);
 			}
 
 			// f
-			for (auto&& triangle_ptr : triangles) {
-				std::vector<int> vertices_3_indices;
-				vertices_3_indices.reserve(3);
+			for (int t = 0; t < trianglesCount; t++) {
+				writer.WriteFace(topology.TriangleVertex(t, 0) + 1LL, topology.TriangleVertex(t, 1) + 1LL, topology.TriangleVertex(t, 2) + 1LL);
+			}
+
+			writer.Close();
+		}
+
+		/*
+			壳s的OBJ路径：output_obj_file_path的扩展名前加上_shell<s>
+		*/
+		static std::string ShellObjPath(const std::string& output_obj_file_path, int s) {
+			size_t dot = output_obj_file_path.find_last_of('.');
+			size_t slash = output_obj_file_path.find_last_of("/\\");
+			if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+				dot = output_obj_file_path.size();
+			}
+			return output_obj_file_path.substr(0, dot) + "_shell" + std::to_string(s) + output_obj_file_path.substr(dot);
+		}
 
-				auto zipped = myzip(triangle_ptr->edges, triangle_ptr->edges_senses);
-				for (const auto& [edge_ptr, edge_sense] : zipped) {
-					if (edge_sense) {
-						vertices_3_indices.emplace_back(edge_ptr->start->id);
+		/*
+			每个壳导出到各自的OBJ（ShellObjPath），顶点按id顺序重新编号，面按三角形顺序输出；各线程依次领取壳
+			未调用LabelShells时先标记壳
+		*/
+		void Export2OBJ_Shells(const std::string& output_obj_file_path, ObjFloatFormat float_format = ObjFloatFormat::GENERAL_6) {
+			if (shellComponents.Count() == 0 && trianglesCount > 0) {
+				LabelShells();
+			}
+
+			int shells_count = shellComponents.Count();
+			std::vector<std::exception_ptr> errors(shells_count);
+
+			unsigned int num_workers = stl_reader::stl_reader_impl::ResolveNumThreads(options.numThreads);
+			num_workers = static_cast<unsigned int>(std::max(1, std::min(static_cast<int>(num_workers), shells_count)));
+
+			std::atomic<int> next_shell(0);
+			stl_reader::stl_reader_impl::RunParallel(num_workers, [&](size_t) {
+				std::vector<int> vertices, edges;
+				for (int s = next_shell.fetch_add(1); s < shells_count; s = next_shell.fetch_add(1)) {
+					try {
+						CollectShellElements(topology, shellComponents, s, vertices, edges);
+
+						ObjWriter writer(ShellObjPath(output_obj_file_path, s), float_format);
+						writer.WriteText("# verticesCount: ");
+						writer.WriteInt(static_cast<long long>(vertices.size()));
+						writer.WriteText("\n# edgesCount: ");
+						writer.WriteInt(static_cast<long long>(edges.size()));
+						writer.WriteText("\n# trianglesCount: ");
+						writer.WriteInt(shellComponents.TrianglesCount(s));
+						writer.WriteText("\n");
+
+						for (int v : vertices) {
+							const STLNonManifold::Geometry::T_NUM* coord = topology.VertexCoord(v);
+							writer.WriteVertex(coord[0], coord[1], coord[2]);
+						}
+
+						// 壳中顶点的新编号为其在vertices中的位置
+						auto local_id = [&](int v) {
+							return static_cast<long long>(std::lower_bound(vertices.begin(), vertices.end(), v) - vertices.begin()) + 1;
+						};
+						for (int i = shellComponents.begin[s]; i < shellComponents.begin[s + 1]; i++) {
+							int t = shellComponents.triangles[i];
+							writer.WriteFace(local_id(topology.TriangleVertex(t, 0)), local_id(topology.TriangleVertex(t, 1)), local_id(topology.TriangleVertex(t, 2)));
+						}
+
+						writer.Close();
 					}
-					else {
-						vertices_3_indices.emplace_back(edge_ptr->end->id);
+					catch (...) {
+						errors[s] = std::current_exception();
 					}
+				}
+			});
 
+			for (auto&& error : errors) {
+				if (error) {
+					std::rethrow_exception(error);
 				}
+			}
+		}
 
+		/*
+			原始的std::fstream逐个输出的导出，作为Export2OBJ的参照
+		*/
+		void Export2OBJ_Stream(const std::string& output_obj_file_path) {
+			std::fstream f;
+			f.open(output_obj_file_path, std::ios::out | std::ios::trunc);
+
+			if (!f.is_open()) {
+				throw std::runtime_error("Open output_obj_file_path failed.");
+			}
+
+			f << "# verticesCount: " << verticesCount << "\n";
+			f << "# edgesCount: " << edgesCount << "\n";
+			f << "# trianglesCount: " << trianglesCount << "\n";
+
+			// v
+			for (int v = 0; v < verticesCount; v++) {
+				const STLNonManifold::Geometry::T_NUM* coord = topology.VertexCoord(v);
+				f << "v " << coord[0] << " " << coord[1] << " " << coord[2] << "\n";
+			}
+
+			// f
+			for (int t = 0; t < trianglesCount; t++) {
 				f << "f";
-				for (auto&& vertices_index : vertices_3_indices) {
-					f <<" " << vertices_index+1;
+				for (int j = 0; j < 3; j++) {
+					f << " " << topology.TriangleVertex(t, j) + 1;
 				}
 				f << "\n";
 			}
@@ -380,12 +1765,17 @@ namespace STLNonManifold {
 			f.close();
 		}
 
-		stl_reader::StlMesh <STLNonManifold::Geometry::T_NUM, unsigned int> mesh;
-		std::vector<std::shared_ptr<STLNonManifold::Geometry::Triangle>> triangles;
+		CheckerOptions options;
+		StlMeshType mesh; // 三角形汤（角点未合并）；使用mappedBinaryReader读取二进制文件时为空
+		STLNonManifold::Geometry::IndexMesh topology;
+		std::vector<int> vertexFans; // 每个顶点周围的扇形数（CountVertexFans），多于1为非流形顶点
+		TriangleComponents shellComponents; // 壳的分组，LabelShells之后有效
+		std::vector<ShellInfo> shells;
 
 		int trianglesCount;
 		int edgesCount;
 		int verticesCount;
+		double loadTimeMs = 0.0;
 	};
 
 } // namespace STLNonManifold
\ No newline at end of file
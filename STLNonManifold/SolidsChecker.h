@@ -0,0 +1,227 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <string>
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+#include "STLNonManifold.h"
+
+/*
+	按solid分别检查，用于含有多个solid块的（ASCII）文件
+
+	- 每个solid单独合并顶点、构造拓扑，多个solid在options.numThreads个线程上并行处理
+	- 非流形按solid分别统计，三角形编号为整个文件中的编号（与STLNonManifoldChecker一致）
+	- 不同solid的顶点不会合并，因此两个solid相接处的边在各自solid中都是边界边；
+	  可用FindSharedEdges找出被多个solid共用的边
+*/
+
+namespace STLNonManifold {
+
+	struct SolidsNonManifoldChecker {
+
+		SolidsNonManifoldChecker(const std::string& stl_file, const CheckerOptions& checker_options = CheckerOptions()) : options(checker_options) {
+			mesh.read_file_soup(stl_file, options.numThreads);
+
+			size_t solids_count = mesh.num_solids();
+			solids.resize(solids_count);
+			solidTrianglesBegin.resize(solids_count);
+			std::vector<std::exception_ptr> errors(solids_count);
+
+			// 每个solid内部单线程，线程用于并行处理多个solid
+			CheckerOptions solid_options = options;
+			solid_options.numThreads = 1;
+
+			unsigned int num_workers = stl_reader::stl_reader_impl::ResolveNumThreads(options.numThreads);
+			num_workers = static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(num_workers, solids_count)));
+
+			std::atomic<size_t> next_solid(0);
+			stl_reader::stl_reader_impl::RunParallel(num_workers, [&](size_t) {
+				for (size_t i_solid = next_solid++; i_solid < solids_count; i_solid = next_solid++) {
+					try {
+						size_t tris_begin = mesh.solid_tris_begin(i_solid);
+						size_t tris_end = mesh.solid_tris_end(i_solid);
+
+						std::vector<STLNonManifold::Geometry::Coordinate> coordinates;
+						coordinates.reserve((tris_end - tris_begin) * 3);
+						for (size_t j_tri = tris_begin; j_tri < tris_end; j_tri++) {
+							for (size_t k = 0; k < 3; k++) {
+								coordinates.emplace_back(mesh.tri_corner_coords(j_tri, k), static_cast<int>(coordinates.size()));
+							}
+						}
+
+						solidTrianglesBegin[i_solid] = static_cast<int>(tris_begin);
+						solids[i_solid] = std::make_unique<STLNonManifoldChecker>(coordinates, solid_options);
+					}
+					catch (...) {
+						errors[i_solid] = std::current_exception();
+					}
+				}
+			});
+
+			for (auto&& error : errors) {
+				if (error) {
+					std::rethrow_exception(error);
+				}
+			}
+
+			for (auto&& solid : solids) {
+				verticesCount += solid->verticesCount;
+				edgesCount += solid->edgesCount;
+				trianglesCount += solid->trianglesCount;
+			}
+
+			LOG_INFO("solidsCount: %d", static_cast<int>(solids_count));
+		}
+
+		/*
+			逐solid输出非流形信息，返回所有solid的非流形总数
+		*/
+		int CheckNonManifold() {
+			int total_non_manifold_count = 0;
+
+			for (size_t i_solid = 0; i_solid < solids.size(); i_solid++) {
+				const STLNonManifoldChecker& solid = *solids[i_solid];
+				const STLNonManifold::Geometry::IndexMesh& topology = solid.topology;
+				int non_manifold_count = 0;
+
+				for (int t = 0; t < solid.trianglesCount; t++) {
+					for (int j = 0; j < 3; j++) {
+						int e = topology.TriangleEdge(t, j);
+						if (topology.IncidentTrianglesCount(e) != 2) {
+							non_manifold_count++;
+
+							const STLNonManifold::Geometry::T_NUM* start_coord = topology.VertexCoord(topology.EdgeStart(e));
+							const STLNonManifold::Geometry::T_NUM* end_coord = topology.VertexCoord(topology.EdgeEnd(e));
+							LOG_INFO("======");
+							LOG_INFO("Solid: %d", static_cast<int>(i_solid));
+							LOG_INFO("NonManifold: %d", topology.IncidentTrianglesCount(e));
+							LOG_INFO("Triangle: %d", solidTrianglesBegin[i_solid] + t);
+							LOG_INFO("Edge: %d", e);
+							LOG_INFO("Start Vertex: %d (%.5lf, %.5lf, %.5lf)", topology.EdgeStart(e), start_coord[0], start_coord[1], start_coord[2]);
+							LOG_INFO("End Vertex: %d (%.5lf, %.5lf, %.5lf)", topology.EdgeEnd(e), end_coord[0], end_coord[1], end_coord[2]);
+							LOG_INFO("======");
+						}
+					}
+				}
+
+				LOG_INFO("Solid %d: verticesCount: %d, edgesCount: %d, trianglesCount: %d, NonManifold Count: %d",
+					static_cast<int>(i_solid), solid.verticesCount, solid.edgesCount, solid.trianglesCount, non_manifold_count);
+				if (non_manifold_count > 0) {
+					std::cout << "Solid " << i_solid << " NonManifold Count: " << non_manifold_count << std::endl;
+				}
+
+				total_non_manifold_count += non_manifold_count;
+			}
+
+			std::cout << "Total NonManifold Count: " << total_non_manifold_count << std::endl;
+			std::cout << "CheckNonManifold end." << std::endl;
+
+			LOG_INFO("Total NonManifold Count: %d", total_non_manifold_count);
+			LOG_INFO("CheckNonManifold end.");
+
+			return total_non_manifold_count;
+		}
+
+		/*
+			查找被多个solid共用的边：所有solid的顶点一起用WeldCoordinates合并，
+			各solid的边按合并后的顶点对排序分组，出现在两个及以上solid中的边即为共用边
+			返回共用边的个数
+		*/
+		int FindSharedEdges() {
+			struct SolidEdge {
+				int p1;
+				int p2;
+				int solid;
+				int edge; // solid中的边编号
+			};
+
+			// 所有solid的顶点，按solid顺序排列
+			std::vector<int> vertices_begin(solids.size() + 1, 0);
+			for (size_t i_solid = 0; i_solid < solids.size(); i_solid++) {
+				vertices_begin[i_solid + 1] = vertices_begin[i_solid] + solids[i_solid]->verticesCount;
+			}
+
+			std::vector<STLNonManifold::Geometry::Coordinate> coordinates(vertices_begin.back());
+			for (size_t i_solid = 0; i_solid < solids.size(); i_solid++) {
+				for (int v = 0; v < solids[i_solid]->verticesCount; v++) {
+					int global_id = vertices_begin[i_solid] + v;
+					coordinates[global_id] = STLNonManifold::Geometry::Coordinate(solids[i_solid]->topology.VertexCoord(v), global_id);
+				}
+			}
+
+			std::vector<int> coordinates_indices = WeldCoordinates(coordinates, options.weldMethod, options.numThreads);
+
+			// 每个solid的每条边记录一次
+			std::vector<SolidEdge> solid_edges;
+			for (size_t i_solid = 0; i_solid < solids.size(); i_solid++) {
+				const STLNonManifold::Geometry::IndexMesh& topology = solids[i_solid]->topology;
+				for (int e = 0; e < topology.EdgesCount(); e++) {
+					int p1 = coordinates_indices[vertices_begin[i_solid] + topology.EdgeStart(e)];
+					int p2 = coordinates_indices[vertices_begin[i_solid] + topology.EdgeEnd(e)];
+					if (p1 == p2) {
+						continue;
+					}
+					if (p1 > p2) {
+						std::swap(p1, p2);
+					}
+					solid_edges.push_back(SolidEdge{ p1, p2, static_cast<int>(i_solid), e });
+				}
+			}
+
+			std::sort(solid_edges.begin(), solid_edges.end(), [](const SolidEdge& a, const SolidEdge& b) {
+				if (a.p1 != b.p1) {
+					return a.p1 < b.p1;
+				}
+				if (a.p2 != b.p2) {
+					return a.p2 < b.p2;
+				}
+				return a.solid < b.solid;
+			});
+
+			int shared_edges_count = 0;
+			for (size_t i = 0; i < solid_edges.size();) {
+				size_t j = i + 1;
+				while (j < solid_edges.size() && solid_edges[j].p1 == solid_edges[i].p1 && solid_edges[j].p2 == solid_edges[i].p2) {
+					j++;
+				}
+
+				// 组内按solid排序，首尾solid不同即出现在多个solid中
+				if (solid_edges[i].solid != solid_edges[j - 1].solid) {
+					shared_edges_count++;
+
+					const STLNonManifold::Geometry::IndexMesh& topology = solids[solid_edges[i].solid]->topology;
+					const STLNonManifold::Geometry::T_NUM* start_coord = topology.VertexCoord(topology.EdgeStart(solid_edges[i].edge));
+					const STLNonManifold::Geometry::T_NUM* end_coord = topology.VertexCoord(topology.EdgeEnd(solid_edges[i].edge));
+					LOG_INFO("======");
+					LOG_INFO("SharedEdge: %d", shared_edges_count - 1);
+					for (size_t k = i; k < j; k++) {
+						LOG_INFO("Solid: %d, Edge: %d, Incident Triangles: %d", solid_edges[k].solid, solid_edges[k].edge, solids[solid_edges[k].solid]->topology.IncidentTrianglesCount(solid_edges[k].edge));
+					}
+					LOG_INFO("Start (%.5lf, %.5lf, %.5lf)", start_coord[0], start_coord[1], start_coord[2]);
+					LOG_INFO("End (%.5lf, %.5lf, %.5lf)", end_coord[0], end_coord[1], end_coord[2]);
+					LOG_INFO("======");
+				}
+
+				i = j;
+			}
+
+			std::cout << "Total Shared Edge Count: " << shared_edges_count << std::endl;
+			LOG_INFO("Total Shared Edge Count: %d", shared_edges_count);
+
+			return shared_edges_count;
+		}
+
+		CheckerOptions options;
+		StlMeshType mesh; // 三角形汤（角点未合并）
+		std::vector<std::unique_ptr<STLNonManifoldChecker>> solids;
+		std::vector<int> solidTrianglesBegin; // 每个solid的第一个三角形在文件中的编号
+
+		int trianglesCount = 0;
+		int edgesCount = 0;
+		int verticesCount = 0;
+	};
+
+} // namespace STLNonManifold
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+/*
+	均匀网格的空间哈希，用于在容差内匹配坐标点，Match的语义与KDTree相同（各维差的绝对值都不超过ERROR_LIMITS的点）
+
+	- 格子边长为CELL_SCALE倍ERROR_LIMITS，查询范围（放宽到2倍ERROR_LIMITS，避免浮点舍入漏掉边界上的点）每一维最多跨两个格子，
+	  大多数点的查询范围不超出所在的格子
+	- 格子坐标用开放寻址的哈希表映射到格子编号，点按格子编号排列，每个格子是points中的一段区间（格子内按原顺序）
+	- 构造与单次查询的期望时间都与点数无关（构造为线性）
+
+	CoordType 约束同KDTree：
+	- 重载了 [] 运算符
+	- 可默认构造
+	- 可复制
+*/
+
+template<typename CoordType, typename T_NUM, int DIM = 3>
+struct SpatialHashGrid {
+
+	// 匹配相同的容差
+	const T_NUM ERROR_LIMITS = 1e-6f;
+
+	// 格子边长与容差之比
+	static constexpr double CELL_SCALE = 64.0;
+
+	struct CellKey {
+		long long k[DIM];
+
+		bool operator==(const CellKey& other) const {
+			for (int i = 0; i < DIM; i++) {
+				if (k[i] != other.k[i]) {
+					return false;
+				}
+			}
+			return true;
+		}
+	};
+
+	SpatialHashGrid() {}
+
+	SpatialHashGrid(const std::vector<CoordType>& coords) {
+		BuildGrid(coords);
+	}
+
+	void BuildGrid(const std::vector<CoordType>& coords) {
+		cellSize = CELL_SCALE * static_cast<double>(ERROR_LIMITS);
+		cellKeys.clear();
+		cellBegin.clear();
+		points.clear();
+
+		// 哈希表容量为不小于2倍点数的2的幂，格子数不超过点数，装载因子不超过1/2
+		size_t capacity = 16;
+		while (capacity < coords.size() * 2) {
+			capacity <<= 1;
+		}
+		table.assign(capacity, -1);
+
+		// 为每个点找到（或新建）所在的格子，并统计每个格子的点数
+		std::vector<int> points_cell(coords.size());
+		for (size_t j = 0; j < coords.size(); j++) {
+			CellKey key = GetCellKey(coords[j]);
+			size_t slot = HashCellKey(key) & (table.size() - 1);
+			while (table[slot] >= 0 && !(cellKeys[table[slot]] == key)) {
+				slot = (slot + 1) & (table.size() - 1);
+			}
+			if (table[slot] < 0) {
+				table[slot] = static_cast<int>(cellKeys.size());
+				cellKeys.push_back(key);
+				cellBegin.push_back(0);
+			}
+			points_cell[j] = table[slot];
+			cellBegin[table[slot]]++;
+		}
+
+		// 计数转为区间起点，再按格子放置点
+		int cells_count = static_cast<int>(cellKeys.size());
+		cellBegin.push_back(0);
+		int offset = 0;
+		for (int c = 0; c <= cells_count; c++) {
+			int count = cellBegin[c];
+			cellBegin[c] = offset;
+			offset += count;
+		}
+
+		points.resize(coords.size());
+		std::vector<int> cell_fill(cellBegin.begin(), cellBegin.end() - 1);
+		for (size_t j = 0; j < coords.size(); j++) {
+			points[cell_fill[points_cell[j]]++] = coords[j];
+		}
+	}
+
+	/*
+		对容差范围内的每个点调用visitor(const CoordType&)
+	*/
+	template<typename Visitor>
+	void ForEachMatch(const CoordType& coord_to_be_matched, Visitor&& visitor) const {
+		if (points.empty()) {
+			return;
+		}
+
+		long long lo[DIM], hi[DIM];
+		for (int i = 0; i < DIM; i++) {
+			lo[i] = GetCellIndex(static_cast<double>(coord_to_be_matched[i]) - 2.0 * ERROR_LIMITS);
+			hi[i] = GetCellIndex(static_cast<double>(coord_to_be_matched[i]) + 2.0 * ERROR_LIMITS);
+		}
+
+		// 逐个枚举lo到hi之间的格子
+		CellKey key;
+		for (int i = 0; i < DIM; i++) {
+			key.k[i] = lo[i];
+		}
+		while (true) {
+			int cell = FindCell(key);
+			if (cell >= 0) {
+				for (int j = cellBegin[cell]; j < cellBegin[cell + 1]; j++) {
+					if (IsSame(points[j], coord_to_be_matched)) {
+						visitor(points[j]);
+					}
+				}
+			}
+
+			int i = 0;
+			while (i < DIM && key.k[i] == hi[i]) {
+				key.k[i] = lo[i];
+				i++;
+			}
+			if (i == DIM) {
+				break;
+			}
+			key.k[i]++;
+		}
+	}
+
+	/*
+		对每一对容差内的点调用visitor(const CoordType&, const CoordType&)，每对只调用一次
+		按格子顺序遍历points：查询范围不超出所在格子时只扫描该格子，不查哈希表
+	*/
+	template<typename Visitor>
+	void ForEachMatchedPair(Visitor&& visitor) const {
+		ForEachMatchedPair(visitor, 0, CellsCount());
+	}
+
+	/*
+		只遍历格子[cell_begin, cell_end)中的点，每对点只在编号较大的格子（或同一格子中较后的点）处调用一次，
+		因此多个线程可以各自处理不相交的格子区间
+	*/
+	template<typename Visitor>
+	void ForEachMatchedPair(Visitor&& visitor, int cell_begin, int cell_end) const {
+		for (int cell = cell_begin; cell < cell_end; cell++) {
+			const CellKey& cell_key = cellKeys[cell];
+
+			for (int j = cellBegin[cell]; j < cellBegin[cell + 1]; j++) {
+				const CoordType& coord = points[j];
+
+				long long lo[DIM], hi[DIM];
+				bool inside_cell = true;
+				for (int i = 0; i < DIM; i++) {
+					lo[i] = GetCellIndex(static_cast<double>(coord[i]) - 2.0 * ERROR_LIMITS);
+					hi[i] = GetCellIndex(static_cast<double>(coord[i]) + 2.0 * ERROR_LIMITS);
+					if (lo[i] != cell_key.k[i] || hi[i] != cell_key.k[i]) {
+						inside_cell = false;
+					}
+				}
+
+				// 同一格子中只与之前的点配对
+				for (int k = cellBegin[cell]; k < j; k++) {
+					if (IsSame(points[k], coord)) {
+						visitor(coord, points[k]);
+					}
+				}
+
+				if (inside_cell) {
+					continue;
+				}
+
+				// 不同格子之间只与编号更小的格子中的点配对
+				CellKey key;
+				for (int i = 0; i < DIM; i++) {
+					key.k[i] = lo[i];
+				}
+				while (true) {
+					int other_cell = FindCell(key);
+					if (other_cell >= 0 && other_cell < cell) {
+						for (int k = cellBegin[other_cell]; k < cellBegin[other_cell + 1]; k++) {
+							if (IsSame(points[k], coord)) {
+								visitor(coord, points[k]);
+							}
+						}
+					}
+
+					int i = 0;
+					while (i < DIM && key.k[i] == hi[i]) {
+						key.k[i] = lo[i];
+						i++;
+					}
+					if (i == DIM) {
+						break;
+					}
+					key.k[i]++;
+				}
+			}
+		}
+	}
+
+	/*
+		匹配相等的坐标点，并返回所有相同的点的vector
+	*/
+	std::vector<CoordType> Match(const CoordType& coord_to_be_matched) const {
+		std::vector<CoordType> result_coords;
+		ForEachMatch(coord_to_be_matched, [&](const CoordType& coord) {
+			result_coords.emplace_back(coord);
+		});
+		return result_coords;
+	}
+
+	int CellsCount() const {
+		return static_cast<int>(cellKeys.size());
+	}
+
+	/*
+		哈希表、格子与点占用的内存（字节）
+	*/
+	size_t MemoryBytes() const {
+		return table.capacity() * sizeof(int) + cellKeys.capacity() * sizeof(CellKey) + cellBegin.capacity() * sizeof(int) + points.capacity() * sizeof(CoordType);
+	}
+
+	double cellSize = 0.0;
+	std::vector<int> table; // 哈希表，保存格子编号，-1为空
+	std::vector<CellKey> cellKeys; // 格子编号 -> 格子坐标
+	std::vector<int> cellBegin; // 格子c中的点为points[cellBegin[c], cellBegin[c + 1])
+	std::vector<CoordType> points;
+
+private:
+	long long GetCellIndex(double value) const {
+		return static_cast<long long>(std::floor(value / cellSize));
+	}
+
+	CellKey GetCellKey(const CoordType& coord) const {
+		CellKey key;
+		for (int i = 0; i < DIM; i++) {
+			key.k[i] = GetCellIndex(static_cast<double>(coord[i]));
+		}
+		return key;
+	}
+
+	static size_t HashCellKey(const CellKey& key) {
+		unsigned long long h = 0;
+		for (int i = 0; i < DIM; i++) {
+			h = (h ^ static_cast<unsigned long long>(key.k[i])) * 0x9E3779B97F4A7C15ull;
+		}
+		return static_cast<size_t>(h ^ (h >> 32));
+	}
+
+	int FindCell(const CellKey& key) const {
+		size_t slot = HashCellKey(key) & (table.size() - 1);
+		while (table[slot] >= 0) {
+			if (cellKeys[table[slot]] == key) {
+				return table[slot];
+			}
+			slot = (slot + 1) & (table.size() - 1);
+		}
+		return -1;
+	}
+
+	bool IsSame(const CoordType& a, const CoordType& b) const {
+		for (int i = 0; i < DIM; i++) {
+			if (std::abs(a[i] - b[i]) > ERROR_LIMITS) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
@@ -0,0 +1,519 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <queue>
+#include <string>
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+#include "STLNonManifold.h"
+
+/*
+	内存受限的流式非流形检查，用于无法整体放入内存的大网格
+
+	- 按块读取三角形，角点坐标按SAME_THRESHOLD量化为整数键
+	- 键、顶点编号和边都写入临时文件，由外部排序（分段排序 + 多路归并）处理
+	- 任一时刻内存中只保留固定预算大小的缓冲区
+
+	与STLNonManifoldChecker的区别：
+	- 焊接为量化焊接：量化键相同的点合并。完全相同的坐标一定合并，
+	  但距离小于容差、落在相邻格子中的点不会合并
+	- 顶点编号按量化键排序，边编号按顶点对排序，与STLNonManifoldChecker的编号不同
+	- 不构造拓扑，不支持Export2OBJ
+*/
+
+namespace STLNonManifold {
+
+	namespace Streaming {
+
+		/*
+			临时文件：析构时删除
+		*/
+		class SpillFile {
+		public:
+			explicit SpillFile(const std::filesystem::path& file_path) : path(file_path) {}
+
+			~SpillFile() {
+				Close();
+				std::error_code ec;
+				std::filesystem::remove(path, ec);
+			}
+
+			SpillFile(const SpillFile&) = delete;
+			SpillFile& operator=(const SpillFile&) = delete;
+
+			void OpenForWrite() {
+				Close();
+				fp = fopen(path.string().c_str(), "wb");
+				if (fp == nullptr) {
+					throw std::runtime_error("Open spill file failed: " + path.string());
+				}
+			}
+
+			void OpenForRead() {
+				Close();
+				fp = fopen(path.string().c_str(), "rb");
+				if (fp == nullptr) {
+					throw std::runtime_error("Open spill file failed: " + path.string());
+				}
+			}
+
+			void Write(const void* data, size_t bytes) {
+				if (bytes > 0 && fwrite(data, 1, bytes, fp) != bytes) {
+					throw std::runtime_error("Write spill file failed (disk full?): " + path.string());
+				}
+			}
+
+			// 返回实际读取的字节数
+			size_t Read(void* data, size_t bytes) {
+				return fread(data, 1, bytes, fp);
+			}
+
+			void Close() {
+				if (fp != nullptr) {
+					fclose(fp);
+					fp = nullptr;
+				}
+			}
+
+			const std::filesystem::path& Path() const {
+				return path;
+			}
+
+		private:
+			std::filesystem::path path;
+			FILE* fp = nullptr;
+		};
+
+		/*
+			在spill_directory下生成不重复的临时文件名
+		*/
+		inline std::filesystem::path MakeSpillPath(const std::filesystem::path& spill_directory, const std::string& name) {
+			static std::atomic<unsigned long> spill_counter(0);
+			return spill_directory / ("stlnm_" + std::to_string(Log44::Utils::getPID()) + "_" + std::to_string(spill_counter++) + "_" + name + ".bin");
+		}
+
+		/*
+			外部排序：缓冲区满时排序并写出一段，最后多路归并所有段
+			Record需可平凡复制
+		*/
+		template<typename Record, typename Less>
+		class ExternalSorter {
+		public:
+			ExternalSorter(size_t memory_budget, const std::filesystem::path& spill_directory, const std::string& sorter_name, Less less_func = Less())
+				: spillDirectory(spill_directory), name(sorter_name), less(less_func) {
+				capacity = std::max<size_t>(memory_budget / sizeof(Record), 1024);
+				buffer.reserve(capacity);
+			}
+
+			void Push(const Record& record) {
+				buffer.push_back(record);
+				recordsCount++;
+				if (buffer.size() >= capacity) {
+					SpillRun();
+				}
+			}
+
+			size_t Size() const {
+				return recordsCount;
+			}
+
+			/*
+				按顺序对每条记录调用func，之后排序器被清空
+			*/
+			template<typename Func>
+			void ForEachSorted(Func func) {
+
+				// 没有写出过：直接在内存中排序
+				if (runs.empty()) {
+					std::sort(buffer.begin(), buffer.end(), less);
+					for (const Record& record : buffer) {
+						func(record);
+					}
+					Clear();
+					return;
+				}
+
+				SpillRun();
+				std::vector<Record>().swap(buffer);
+
+				// 每段分到的读缓冲区
+				size_t run_buffer_size = std::max<size_t>(capacity / runs.size(), 1024);
+
+				struct RunReader {
+					SpillFile* file;
+					std::vector<Record> records;
+					size_t pos = 0;
+
+					bool Refill() {
+						records.resize(records.capacity());
+						size_t n = file->Read(records.data(), records.size() * sizeof(Record)) / sizeof(Record);
+						records.resize(n);
+						pos = 0;
+						return n > 0;
+					}
+				};
+
+				std::vector<RunReader> readers(runs.size());
+				for (size_t i = 0; i < runs.size(); i++) {
+					runs[i]->OpenForRead();
+					readers[i].file = runs[i].get();
+					readers[i].records.reserve(run_buffer_size);
+				}
+
+				// 小顶堆：(记录, 段号)
+				auto heap_less = [&](const std::pair<Record, size_t>& a, const std::pair<Record, size_t>& b) {
+					return less(b.first, a.first);
+				};
+				std::priority_queue<std::pair<Record, size_t>, std::vector<std::pair<Record, size_t>>, decltype(heap_less)> heap(heap_less);
+
+				for (size_t i = 0; i < readers.size(); i++) {
+					if (readers[i].Refill()) {
+						heap.emplace(readers[i].records[readers[i].pos++], i);
+					}
+				}
+
+				while (!heap.empty()) {
+					auto top = heap.top();
+					heap.pop();
+					func(top.first);
+
+					RunReader& reader = readers[top.second];
+					if (reader.pos < reader.records.size() || reader.Refill()) {
+						heap.emplace(reader.records[reader.pos++], top.second);
+					}
+				}
+
+				Clear();
+			}
+
+		private:
+			void SpillRun() {
+				if (buffer.empty()) {
+					return;
+				}
+
+				std::sort(buffer.begin(), buffer.end(), less);
+
+				auto run = std::make_unique<SpillFile>(MakeSpillPath(spillDirectory, name));
+				run->OpenForWrite();
+				run->Write(buffer.data(), buffer.size() * sizeof(Record));
+				run->Close();
+				runs.emplace_back(std::move(run));
+
+				buffer.clear();
+			}
+
+			void Clear() {
+				std::vector<Record>().swap(buffer);
+				runs.clear();
+				recordsCount = 0;
+			}
+
+			std::filesystem::path spillDirectory;
+			std::string name;
+			Less less;
+			size_t capacity;
+			size_t recordsCount = 0;
+			std::vector<Record> buffer;
+			std::vector<std::unique_ptr<SpillFile>> runs;
+		};
+
+		// 角点：量化键 + 角点序号 + 原始坐标
+		struct CornerRecord {
+			int64_t key[3];
+			uint64_t corner;
+			STLNonManifold::Geometry::T_NUM coords[3];
+		};
+
+		struct CornerKeyLess {
+			bool operator()(const CornerRecord& a, const CornerRecord& b) const {
+				for (int i = 0; i < 3; i++) {
+					if (a.key[i] != b.key[i]) {
+						return a.key[i] < b.key[i];
+					}
+				}
+				return a.corner < b.corner;
+			}
+		};
+
+		// 角点 -> 焊接后的顶点编号
+		struct CornerVertexRecord {
+			uint64_t corner;
+			uint32_t vertex;
+		};
+
+		struct CornerLess {
+			bool operator()(const CornerVertexRecord& a, const CornerVertexRecord& b) const {
+				return a.corner < b.corner;
+			}
+		};
+
+		// 边：(较小顶点编号, 较大顶点编号, 三角形编号)
+		struct EdgeRecord {
+			uint32_t start;
+			uint32_t end;
+			uint32_t triangle;
+		};
+
+		struct EdgeLess {
+			bool operator()(const EdgeRecord& a, const EdgeRecord& b) const {
+				if (a.start != b.start) {
+					return a.start < b.start;
+				}
+				if (a.end != b.end) {
+					return a.end < b.end;
+				}
+				return a.triangle < b.triangle;
+			}
+		};
+
+		// 非流形边上的一个三角形
+		struct NonManifoldRecord {
+			uint32_t edge;
+			uint32_t start;
+			uint32_t end;
+			uint32_t triangle;
+			uint32_t incidentTrianglesCount;
+		};
+
+		/*
+			逐块读取文件中的三角形，对每个非退化三角形调用func(const T_NUM corners[9])
+			二进制文件通过内存映射逐条读取；ASCII文件按facet行切块解析，每块约chunk_bytes字节
+			gzip压缩的文件边解压边解析，每块为解压出的一个数据块（需定义STL_READER_WITH_ZLIB）
+		*/
+		template<typename Func>
+		void ForEachTriangle(const std::string& stl_file, size_t chunk_bytes, Func func) {
+			using STLNonManifold::Geometry::T_NUM;
+
+			auto is_degenerate = [](const T_NUM* c) {
+				auto same = [&](int a, int b) {
+					return c[a * 3] == c[b * 3] && c[a * 3 + 1] == c[b * 3 + 1] && c[a * 3 + 2] == c[b * 3 + 2];
+				};
+				return same(0, 1) || same(0, 2) || same(1, 2);
+			};
+
+			T_NUM corners[9];
+
+			std::vector<stl_reader::stl_reader_impl::CoordWithIndex<T_NUM, unsigned int>> coords_with_index;
+			std::vector<T_NUM> normals;
+			std::vector<unsigned int> tris, solids;
+
+			// 处理并清空当前块解析出的三角形
+			auto flush_triangles = [&]() {
+				for (size_t i = 0; i < tris.size(); i += 3) {
+					for (size_t k = 0; k < 3; k++) {
+						const auto& c = coords_with_index[tris[i + k]];
+						corners[k * 3] = c[0];
+						corners[k * 3 + 1] = c[1];
+						corners[k * 3 + 2] = c[2];
+					}
+					if (!is_degenerate(corners)) {
+						func(static_cast<const T_NUM*>(corners));
+					}
+				}
+
+				coords_with_index.clear();
+				normals.clear();
+				tris.clear();
+				solids.clear();
+			};
+
+			if (stl_reader::StlFileIsGzip(stl_file.c_str())) {
+#ifdef STL_READER_WITH_ZLIB
+				stl_reader::stl_reader_impl::ParseStlStream_GZIP(stl_file.c_str(), coords_with_index, normals, tris, solids, flush_triangles);
+				return;
+#else
+				throw std::runtime_error("Cannot read gzip compressed stl file " + stl_file + ": compiled without zlib (define STL_READER_WITH_ZLIB)");
+#endif
+			}
+
+			if (!stl_reader::StlFileHasASCIIFormat(stl_file.c_str())) {
+				StlBinaryViewType view(stl_file);
+				for (size_t i_tri = 0; i_tri < view.num_tris(); i_tri++) {
+					for (size_t k = 0; k < 3; k++) {
+						view.tri_corner_coords(i_tri, k, corners + k * 3);
+					}
+					if (!is_degenerate(corners)) {
+						func(static_cast<const T_NUM*>(corners));
+					}
+				}
+				return;
+			}
+
+			stl_reader::MappedFile file;
+			file.open(stl_file.c_str());
+			const char* data = file.data();
+			const char* data_end = data + file.size();
+
+			const char* chunk_begin = data;
+			while (chunk_begin < data_end) {
+				const char* chunk_end = stl_reader::stl_reader_impl::FindFacetLine(data, std::min<const char*>(chunk_begin + chunk_bytes, data_end), data_end);
+
+				stl_reader::stl_reader_impl::ParseStlBuffer_ASCII(stl_file.c_str(), data, chunk_begin, chunk_end, coords_with_index, normals, tris, solids);
+				flush_triangles();
+
+				chunk_begin = chunk_end;
+			}
+		}
+
+	}
+
+	struct StreamingNonManifoldChecker {
+
+		StreamingNonManifoldChecker(const std::string& stl_file, const CheckerOptions& checker_options = CheckerOptions()) : options(checker_options) {
+			using namespace STLNonManifold::Streaming;
+
+			size_t memory_budget = std::max<size_t>(options.memoryBudgetMB, 1) << 20;
+			spillDirectory = options.spillDirectory.empty() ? std::filesystem::temp_directory_path() : std::filesystem::path(options.spillDirectory);
+
+			// 同一时刻最多两个排序器工作（一个归并、一个写入），各占一半预算
+			size_t sorter_budget = memory_budget / 2;
+
+			// 1. 读取三角形，写出量化后的角点
+			ExternalSorter<CornerRecord, CornerKeyLess> corner_sorter(sorter_budget, spillDirectory, "corners");
+			uint64_t corners_count = 0;
+			ForEachTriangle(stl_file, memory_budget / 4, [&](const STLNonManifold::Geometry::T_NUM* corners) {
+				for (int k = 0; k < 3; k++) {
+					CornerRecord record;
+					for (int i = 0; i < 3; i++) {
+						record.coords[i] = corners[k * 3 + i];
+						record.key[i] = std::llround(static_cast<double>(corners[k * 3 + i]) / STLNonManifold::Geometry::SAME_THRESHOLD);
+					}
+					record.corner = corners_count++;
+					corner_sorter.Push(record);
+				}
+			});
+			trianglesCount = corners_count / 3;
+
+			// 2. 按量化键归并，相同键的角点合并为同一顶点；顶点坐标取序号最小的角点，写入顶点文件
+			ExternalSorter<CornerVertexRecord, CornerLess> vertex_sorter(sorter_budget, spillDirectory, "vertices");
+			verticesFile = std::make_unique<SpillFile>(MakeSpillPath(spillDirectory, "vertex_coords"));
+			verticesFile->OpenForWrite();
+
+			int64_t vertices_count = 0;
+			const int64_t* last_key = nullptr;
+			int64_t last_key_storage[3];
+			corner_sorter.ForEachSorted([&](const CornerRecord& record) {
+				if (last_key == nullptr || memcmp(last_key, record.key, sizeof(record.key)) != 0) {
+					verticesFile->Write(record.coords, sizeof(record.coords));
+					memcpy(last_key_storage, record.key, sizeof(record.key));
+					last_key = last_key_storage;
+					vertices_count++;
+				}
+
+				if (vertices_count > static_cast<int64_t>(UINT32_MAX)) {
+					throw std::runtime_error("Too many vertices for streaming check.");
+				}
+
+				vertex_sorter.Push(CornerVertexRecord{ record.corner, static_cast<uint32_t>(vertices_count - 1) });
+			});
+			verticesFile->Close();
+			verticesCount = vertices_count;
+
+			// 3. 按角点顺序还原三角形，写出边
+			ExternalSorter<EdgeRecord, EdgeLess> edge_sorter(sorter_budget, spillDirectory, "edges");
+			uint32_t triangle_vertices[3];
+			vertex_sorter.ForEachSorted([&](const CornerVertexRecord& record) {
+				triangle_vertices[record.corner % 3] = record.vertex;
+				if (record.corner % 3 == 2) {
+					uint32_t triangle_id = static_cast<uint32_t>(record.corner / 3);
+					for (int j = 0; j < 3; j++) {
+						uint32_t p1 = triangle_vertices[j];
+						uint32_t p2 = triangle_vertices[(j + 1) % 3];
+						if (p1 > p2) {
+							std::swap(p1, p2);
+						}
+						edge_sorter.Push(EdgeRecord{ p1, p2, triangle_id });
+					}
+				}
+			});
+
+			// 4. 按顶点对归并边，统计每条边的关联三角形数；非流形边写入结果文件
+			nonManifoldFile = std::make_unique<SpillFile>(MakeSpillPath(spillDirectory, "non_manifold"));
+			nonManifoldFile->OpenForWrite();
+
+			int64_t edges_count = 0;
+			std::vector<EdgeRecord> same_edges;
+			auto flush_edge = [&]() {
+				if (same_edges.empty()) {
+					return;
+				}
+				if (same_edges.size() != 2) {
+					for (const EdgeRecord& edge : same_edges) {
+						NonManifoldRecord record{ static_cast<uint32_t>(edges_count), edge.start, edge.end, edge.triangle, static_cast<uint32_t>(same_edges.size()) };
+						nonManifoldFile->Write(&record, sizeof(record));
+						nonManifoldCount++;
+					}
+				}
+				edges_count++;
+				same_edges.clear();
+			};
+
+			edge_sorter.ForEachSorted([&](const EdgeRecord& edge) {
+				if (!same_edges.empty() && (same_edges.front().start != edge.start || same_edges.front().end != edge.end)) {
+					flush_edge();
+				}
+				same_edges.emplace_back(edge);
+			});
+			flush_edge();
+			nonManifoldFile->Close();
+			edgesCount = edges_count;
+
+			LOG_INFO("verticesCount: %lld", static_cast<long long>(verticesCount));
+			LOG_INFO("edgesCount: %lld", static_cast<long long>(edgesCount));
+			LOG_INFO("trianglesCount: %lld", static_cast<long long>(trianglesCount));
+		}
+
+		void CheckNonManifold() {
+			using namespace STLNonManifold::Streaming;
+
+			// 顶点文件通过内存映射按编号读取坐标
+			stl_reader::MappedFile vertices_map;
+			vertices_map.open(verticesFile->Path().string().c_str());
+
+			auto vertex_coords = [&](uint32_t vertex_id, STLNonManifold::Geometry::T_NUM* coords) {
+				memcpy(coords, vertices_map.data() + static_cast<size_t>(vertex_id) * sizeof(STLNonManifold::Geometry::T_NUM) * 3, sizeof(STLNonManifold::Geometry::T_NUM) * 3);
+			};
+
+			nonManifoldFile->OpenForRead();
+			NonManifoldRecord record;
+			while (nonManifoldFile->Read(&record, sizeof(record)) == sizeof(record)) {
+				STLNonManifold::Geometry::T_NUM start[3], end[3];
+				vertex_coords(record.start, start);
+				vertex_coords(record.end, end);
+
+				LOG_INFO("======");
+				LOG_INFO("NonManifold: %u", record.incidentTrianglesCount);
+				LOG_INFO("Triangle: %u", record.triangle);
+				LOG_INFO("Edge: %u", record.edge);
+				LOG_INFO("Start Vertex: %u (%.5lf, %.5lf, %.5lf)", record.start, start[0], start[1], start[2]);
+				LOG_INFO("End Vertex: %u (%.5lf, %.5lf, %.5lf)", record.end, end[0], end[1], end[2]);
+				LOG_INFO("======");
+			}
+			nonManifoldFile->Close();
+
+			std::cout << "Total NonManifold Count: " << nonManifoldCount << std::endl;
+			std::cout << "CheckNonManifold end." << std::endl;
+
+			LOG_INFO("Total NonManifold Count: %lld", static_cast<long long>(nonManifoldCount));
+			LOG_INFO("CheckNonManifold end.");
+		}
+
+		CheckerOptions options;
+		std::filesystem::path spillDirectory;
+		std::unique_ptr<STLNonManifold::Streaming::SpillFile> verticesFile; // 顶点坐标，按顶点编号存放
+		std::unique_ptr<STLNonManifold::Streaming::SpillFile> nonManifoldFile; // 非流形边上的(边, 三角形)
+
+		int64_t trianglesCount = 0;
+		int64_t edgesCount = 0;
+		int64_t verticesCount = 0;
+		int64_t nonManifoldCount = 0;
+	};
+
+} // namespace STLNonManifold
@@ -0,0 +1,413 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <initializer_list>
+
+namespace STLNonManifold {
+
+	/*
+		三角形包围盒的层次结构（BVH），用于找出包围盒相交的三角形对
+
+		- 节点按先序存放在一个vector中：左子节点紧跟在父节点之后，只记录右子节点的下标（同FlatKDTree）
+		- 三角形（及其包围盒）按叶子顺序存放在primitives中，每个叶子是一段区间
+		- 分桶的SAH：沿三角形包围盒中心范围最长的一维分为BIN_COUNT个桶，选表面积代价最小的划分位置；
+		  深度超过MAX_SAH_DEPTH后改为在中心的中位数处划分，限制树的深度
+		- num_threads > 1时，上层的左子树交给新线程构造到各自的数组再拼接，结果与单线程构造完全相同
+	*/
+	class TriangleBVH {
+	public:
+		// 每一维的桶数
+		static constexpr int BIN_COUNT = 16;
+
+		// 三角形数不超过该值的节点为叶子
+		static constexpr int MAX_LEAF_SIZE = 8;
+
+		static constexpr int MAX_SAH_DEPTH = 64;
+
+		// 三角形数不超过该值的子树不再拆分到新线程
+		static constexpr int PARALLEL_GRAIN_SIZE = 1 << 16;
+
+		// 并行遍历时每个线程平均分到的任务数
+		static constexpr int TASKS_PER_THREAD = 64;
+
+		struct Box {
+			float minRange[3];
+			float maxRange[3];
+
+			bool Overlaps(const Box& other) const {
+				return minRange[0] <= other.maxRange[0] && other.minRange[0] <= maxRange[0]
+					&& minRange[1] <= other.maxRange[1] && other.minRange[1] <= maxRange[1]
+					&& minRange[2] <= other.maxRange[2] && other.minRange[2] <= maxRange[2];
+			}
+		};
+
+		struct Primitive {
+			Box box;
+			int triangle;
+		};
+
+		struct Node {
+			Box box;
+			int begin = 0; // 子树中的三角形在primitives中的区间[begin, end)
+			int end = 0;
+			int rightNode = -1; // 右子节点的下标，-1表示叶子节点；左子节点的下标为当前下标+1
+
+			bool IsLeaf() const {
+				return rightNode < 0;
+			}
+		};
+
+		TriangleBVH() {}
+
+		/*
+			vertex_coords为顶点坐标（每个顶点3个float），三角形t的角点为triangle_vertices[3t, 3t + 3)
+		*/
+		TriangleBVH(const float* vertex_coords, const std::vector<int32_t>& triangle_vertices, unsigned int num_threads = 1) {
+			BuildTree(vertex_coords, triangle_vertices, num_threads);
+		}
+
+		void BuildTree(const float* vertex_coords, const std::vector<int32_t>& triangle_vertices, unsigned int num_threads = 1) {
+			nodes.clear();
+			int triangles_count = static_cast<int>(triangle_vertices.size() / 3);
+			primitives.resize(triangles_count);
+			if (triangles_count == 0) {
+				return;
+			}
+
+			for (int t = 0; t < triangles_count; t++) {
+				Primitive& primitive = primitives[t];
+				primitive.triangle = t;
+				for (int i = 0; i < 3; i++) {
+					primitive.box.minRange[i] = std::numeric_limits<float>::max();
+					primitive.box.maxRange[i] = std::numeric_limits<float>::lowest();
+				}
+				for (int j = 0; j < 3; j++) {
+					const float* coord = &vertex_coords[static_cast<size_t>(triangle_vertices[static_cast<size_t>(t) * 3 + j]) * 3];
+					for (int i = 0; i < 3; i++) {
+						primitive.box.minRange[i] = std::min(primitive.box.minRange[i], coord[i]);
+						primitive.box.maxRange[i] = std::max(primitive.box.maxRange[i], coord[i]);
+					}
+				}
+			}
+
+			BuildNode(nodes, 0, triangles_count, 0, std::max(1u, num_threads));
+		}
+
+		/*
+			对每一对包围盒相交的三角形调用visitor(thread_index, triangle_a, triangle_b)，每对只调用一次
+			num_threads > 1时先把遍历展开为约TASKS_PER_THREAD * num_threads个互不重叠的节点对，各线程依次领取；
+			调用的顺序与线程数有关
+		*/
+		template<typename Visitor>
+		void ForEachOverlappingPair(Visitor&& visitor, unsigned int num_threads = 1) const {
+			if (nodes.empty()) {
+				return;
+			}
+			num_threads = std::max(1u, num_threads);
+
+			// 节点对(a, b)，a == b表示节点a内部的三角形对
+			std::vector<std::pair<int, int>> tasks(1, std::make_pair(0, 0));
+			size_t target_tasks = num_threads > 1 ? static_cast<size_t>(TASKS_PER_THREAD) * num_threads : 1;
+			while (tasks.size() < target_tasks) {
+				std::vector<std::pair<int, int>> next_tasks;
+				bool expanded = false;
+				for (auto&& task : tasks) {
+					if (IsLeafTask(task)) {
+						next_tasks.push_back(task);
+					}
+					else {
+						ExpandTask(task, [&](int a, int b) { next_tasks.emplace_back(a, b); });
+						expanded = true;
+					}
+				}
+				tasks.swap(next_tasks);
+				if (!expanded) {
+					break;
+				}
+			}
+
+			std::atomic<size_t> next_task(0);
+			auto worker = [&](size_t thread_index) {
+				std::vector<std::pair<int, int>> stack;
+				for (size_t i = next_task++; i < tasks.size(); i = next_task++) {
+					stack.push_back(tasks[i]);
+					while (!stack.empty()) {
+						std::pair<int, int> task = stack.back();
+						stack.pop_back();
+						if (IsLeafTask(task)) {
+							VisitLeafTask(task, visitor, thread_index);
+						}
+						else {
+							ExpandTask(task, [&](int a, int b) { stack.emplace_back(a, b); });
+						}
+					}
+				}
+			};
+
+			std::vector<std::thread> threads;
+			for (unsigned int r = 1; r < num_threads; r++) {
+				threads.emplace_back(worker, r);
+			}
+			worker(0);
+			for (auto&& thread : threads) {
+				thread.join();
+			}
+		}
+
+		/*
+			节点与三角形占用的内存（字节）
+		*/
+		size_t MemoryBytes() const {
+			return nodes.capacity() * sizeof(Node) + primitives.capacity() * sizeof(Primitive);
+		}
+
+		std::vector<Node> nodes;
+		std::vector<Primitive> primitives;
+
+	private:
+		/*
+			包围盒中心的2倍（只用于比较与分桶）
+		*/
+		static float Centroid(const Box& box, int axis) {
+			return box.minRange[axis] + box.maxRange[axis];
+		}
+
+		/*
+			包围盒表面积的一半
+		*/
+		static float HalfArea(const Box& box) {
+			float dx = box.maxRange[0] - box.minRange[0];
+			float dy = box.maxRange[1] - box.minRange[1];
+			float dz = box.maxRange[2] - box.minRange[2];
+			return dx * dy + dy * dz + dz * dx;
+		}
+
+		static void EmptyBox(Box& box) {
+			for (int i = 0; i < 3; i++) {
+				box.minRange[i] = std::numeric_limits<float>::max();
+				box.maxRange[i] = std::numeric_limits<float>::lowest();
+			}
+		}
+
+		static void GrowBox(Box& box, const Box& other) {
+			for (int i = 0; i < 3; i++) {
+				box.minRange[i] = std::min(box.minRange[i], other.minRange[i]);
+				box.maxRange[i] = std::max(box.maxRange[i], other.maxRange[i]);
+			}
+		}
+
+		/*
+			在out末尾构造primitives[l, r)的子树，子树的节点依次存放在其根之后
+			num_threads为该子树可用的线程数
+		*/
+		void BuildNode(std::vector<Node>& out, int l, int r, int depth, unsigned int num_threads) {
+			int node_index = static_cast<int>(out.size());
+			out.emplace_back();
+
+			// 节点的包围盒与三角形包围盒中心的范围
+			Node node;
+			node.begin = l;
+			node.end = r;
+			EmptyBox(node.box);
+			Box centroid_box;
+			EmptyBox(centroid_box);
+			for (int j = l; j < r; j++) {
+				const Box& box = primitives[j].box;
+				for (int i = 0; i < 3; i++) {
+					node.box.minRange[i] = std::min(node.box.minRange[i], box.minRange[i]);
+					node.box.maxRange[i] = std::max(node.box.maxRange[i], box.maxRange[i]);
+					centroid_box.minRange[i] = std::min(centroid_box.minRange[i], Centroid(box, i));
+					centroid_box.maxRange[i] = std::max(centroid_box.maxRange[i], Centroid(box, i));
+				}
+			}
+
+			int mid = Split(centroid_box, l, r, depth);
+			if (mid > l) {
+				if (num_threads > 1 && r - l > PARALLEL_GRAIN_SIZE) {
+					// 左子树交给新线程，两边按线程数平分，构造完成后按先序拼接
+					unsigned int left_threads = num_threads / 2;
+					std::vector<Node> left_nodes;
+					std::thread left_thread([&]() {
+						BuildNode(left_nodes, l, mid, depth + 1, left_threads);
+					});
+					std::vector<Node> right_nodes;
+					BuildNode(right_nodes, mid, r, depth + 1, num_threads - left_threads);
+					left_thread.join();
+
+					AppendNodes(out, left_nodes);
+					node.rightNode = static_cast<int>(out.size());
+					AppendNodes(out, right_nodes);
+				}
+				else {
+					BuildNode(out, l, mid, depth + 1, 1);
+					node.rightNode = static_cast<int>(out.size());
+					BuildNode(out, mid, r, depth + 1, 1);
+				}
+			}
+
+			out[node_index] = node;
+		}
+
+		static void AppendNodes(std::vector<Node>& out, const std::vector<Node>& sub_nodes) {
+			int offset = static_cast<int>(out.size());
+			for (Node node : sub_nodes) {
+				if (!node.IsLeaf()) {
+					node.rightNode += offset;
+				}
+				out.push_back(node);
+			}
+		}
+
+		/*
+			划分primitives[l, r)，返回右半部分的起点；返回l时该节点为叶子
+			centroid_box为三角形包围盒中心的范围，沿其最长的一维分桶
+		*/
+		int Split(const Box& centroid_box, int l, int r, int depth) {
+			int count = r - l;
+			if (count <= MAX_LEAF_SIZE) {
+				return l;
+			}
+
+			int axis = 0;
+			for (int i = 1; i < 3; i++) {
+				if (centroid_box.maxRange[i] - centroid_box.minRange[i] > centroid_box.maxRange[axis] - centroid_box.minRange[axis]) {
+					axis = i;
+				}
+			}
+			float centroid_min = centroid_box.minRange[axis];
+			float extent = centroid_box.maxRange[axis] - centroid_min;
+
+			// 中心全部重合：无法按位置划分，按下标对半分
+			if (!(extent > 0.0f)) {
+				return l + count / 2;
+			}
+
+			if (depth >= MAX_SAH_DEPTH) {
+				int mid = l + count / 2;
+				std::nth_element(primitives.begin() + l, primitives.begin() + mid, primitives.begin() + r, [&](const Primitive& a, const Primitive& b) {
+					return Centroid(a.box, axis) < Centroid(b.box, axis);
+				});
+				return mid;
+			}
+
+			// 分桶，计算每个划分位置的代价：左右两侧的三角形数乘以包围盒表面积
+			float scale = BIN_COUNT / extent;
+			int bin_counts[BIN_COUNT] = {};
+			Box bin_boxes[BIN_COUNT];
+			for (int b = 0; b < BIN_COUNT; b++) {
+				EmptyBox(bin_boxes[b]);
+			}
+			for (int j = l; j < r; j++) {
+				int b = BinIndex(primitives[j].box, axis, centroid_min, scale);
+				bin_counts[b]++;
+				GrowBox(bin_boxes[b], primitives[j].box);
+			}
+
+			// right_costs[b]为桶[b, BIN_COUNT)的代价
+			float right_costs[BIN_COUNT];
+			Box right_box;
+			EmptyBox(right_box);
+			int right_count = 0;
+			for (int b = BIN_COUNT - 1; b > 0; b--) {
+				right_count += bin_counts[b];
+				GrowBox(right_box, bin_boxes[b]);
+				right_costs[b] = right_count > 0 ? right_count * HalfArea(right_box) : 0.0f;
+			}
+
+			float best_cost = std::numeric_limits<float>::max();
+			int best_bin = 0;
+			Box left_box;
+			EmptyBox(left_box);
+			int left_count = 0;
+			for (int b = 1; b < BIN_COUNT; b++) {
+				left_count += bin_counts[b - 1];
+				GrowBox(left_box, bin_boxes[b - 1]);
+				if (left_count == 0 || left_count == count) {
+					continue;
+				}
+				float cost = left_count * HalfArea(left_box) + right_costs[b];
+				if (cost < best_cost) {
+					best_cost = cost;
+					best_bin = b;
+				}
+			}
+
+			// 中心最小与最大的三角形分别在第一个与最后一个桶中，总有可用的划分位置
+			auto it = std::partition(primitives.begin() + l, primitives.begin() + r, [&](const Primitive& primitive) {
+				return BinIndex(primitive.box, axis, centroid_min, scale) < best_bin;
+			});
+			return static_cast<int>(it - primitives.begin());
+		}
+
+		static int BinIndex(const Box& box, int axis, float centroid_min, float scale) {
+			int b = static_cast<int>((Centroid(box, axis) - centroid_min) * scale);
+			return std::min(std::max(b, 0), BIN_COUNT - 1);
+		}
+
+		bool IsLeafTask(const std::pair<int, int>& task) const {
+			return nodes[task.first].IsLeaf() && nodes[task.second].IsLeaf();
+		}
+
+		/*
+			把非叶子的节点对拆分为子节点对，只保留包围盒相交的
+			(a, a)拆为两个子节点各自内部与两者之间；(a, b)拆开三角形数较多的非叶子节点
+		*/
+		template<typename Push>
+		void ExpandTask(const std::pair<int, int>& task, Push&& push) const {
+			int a = task.first;
+			int b = task.second;
+			if (a == b) {
+				int left = a + 1;
+				int right = nodes[a].rightNode;
+				push(left, left);
+				push(right, right);
+				if (nodes[left].box.Overlaps(nodes[right].box)) {
+					push(left, right);
+				}
+				return;
+			}
+
+			const Node& node_a = nodes[a];
+			const Node& node_b = nodes[b];
+			bool split_a = node_b.IsLeaf() || (!node_a.IsLeaf() && node_a.end - node_a.begin >= node_b.end - node_b.begin);
+			int split = split_a ? a : b;
+			int other = split_a ? b : a;
+			for (int child : { split + 1, nodes[split].rightNode }) {
+				if (nodes[child].box.Overlaps(nodes[other].box)) {
+					push(child, other);
+				}
+			}
+		}
+
+		template<typename Visitor>
+		void VisitLeafTask(const std::pair<int, int>& task, Visitor& visitor, size_t thread_index) const {
+			const Node& node_a = nodes[task.first];
+			const Node& node_b = nodes[task.second];
+			if (task.first == task.second) {
+				for (int i = node_a.begin; i < node_a.end; i++) {
+					for (int j = i + 1; j < node_a.end; j++) {
+						if (primitives[i].box.Overlaps(primitives[j].box)) {
+							visitor(thread_index, primitives[i].triangle, primitives[j].triangle);
+						}
+					}
+				}
+				return;
+			}
+
+			for (int i = node_a.begin; i < node_a.end; i++) {
+				for (int j = node_b.begin; j < node_b.end; j++) {
+					if (primitives[i].box.Overlaps(primitives[j].box)) {
+						visitor(thread_index, primitives[i].triangle, primitives[j].triangle);
+					}
+				}
+			}
+		}
+	};
+
+} // namespace STLNonManifold
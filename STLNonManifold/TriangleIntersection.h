@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <initializer_list>
+
+namespace STLNonManifold {
+
+	/*
+		三角形相交判断，只用orient3d / orient2d的符号
+
+		- 谓词在double中计算，并用Shewchuk的误差界（errboundA）过滤：|det|超过误差界时符号一定正确，
+		  否则返回0，即按共面 / 共线处理；不做精确算术的回退，符号不确定的情形都按接触处理（宁可多报）
+		- 两个三角形相交（包括接触）当且仅当某个三角形的某条边与另一个三角形相交
+		- 三角形不能退化（三点共线），退化的三角形由调用者排除
+	*/
+	namespace Intersection {
+
+		// double的单位舍入误差 2^-53
+		static constexpr double EPSILON = std::numeric_limits<double>::epsilon() * 0.5;
+		static constexpr double ORIENT2D_ERROR_BOUND = (3.0 + 16.0 * EPSILON) * EPSILON;
+		static constexpr double ORIENT3D_ERROR_BOUND = (7.0 + 56.0 * EPSILON) * EPSILON;
+
+		/*
+			d在a、b、c所在平面的哪一侧：1、-1，在平面上（或符号不确定）时为0
+		*/
+		inline int Orient3D(const double* a, const double* b, const double* c, const double* d) {
+			double adx = a[0] - d[0], ady = a[1] - d[1], adz = a[2] - d[2];
+			double bdx = b[0] - d[0], bdy = b[1] - d[1], bdz = b[2] - d[2];
+			double cdx = c[0] - d[0], cdy = c[1] - d[1], cdz = c[2] - d[2];
+
+			double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+			double cdxady = cdx * ady, adxcdy = adx * cdy;
+			double adxbdy = adx * bdy, bdxady = bdx * ady;
+
+			double det = adz * (bdxcdy - cdxbdy) + bdz * (cdxady - adxcdy) + cdz * (adxbdy - bdxady);
+			double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * std::abs(adz)
+				+ (std::abs(cdxady) + std::abs(adxcdy)) * std::abs(bdz)
+				+ (std::abs(adxbdy) + std::abs(bdxady)) * std::abs(cdz);
+			double error_bound = ORIENT3D_ERROR_BOUND * permanent;
+
+			if (det > error_bound) {
+				return 1;
+			}
+			if (det < -error_bound) {
+				return -1;
+			}
+			return 0;
+		}
+
+		/*
+			二维的orient：c在有向直线ab的哪一侧，坐标取x_axis、y_axis两维
+		*/
+		inline int Orient2D(const double* a, const double* b, const double* c, int x_axis, int y_axis) {
+			double det_left = (a[x_axis] - c[x_axis]) * (b[y_axis] - c[y_axis]);
+			double det_right = (a[y_axis] - c[y_axis]) * (b[x_axis] - c[x_axis]);
+			double det = det_left - det_right;
+			double error_bound = ORIENT2D_ERROR_BOUND * (std::abs(det_left) + std::abs(det_right));
+
+			if (det > error_bound) {
+				return 1;
+			}
+			if (det < -error_bound) {
+				return -1;
+			}
+			return 0;
+		}
+
+		/*
+			三个符号中既有正又有负
+		*/
+		inline bool MixedSigns(int s0, int s1, int s2) {
+			return (s0 > 0 || s1 > 0 || s2 > 0) && (s0 < 0 || s1 < 0 || s2 < 0);
+		}
+
+		/*
+			与a、b、c共线的点p是否在线段ab上（按两维的范围判断）
+		*/
+		inline bool OnSegment2D(const double* a, const double* b, const double* p, int x_axis, int y_axis) {
+			return std::min(a[x_axis], b[x_axis]) <= p[x_axis] && p[x_axis] <= std::max(a[x_axis], b[x_axis])
+				&& std::min(a[y_axis], b[y_axis]) <= p[y_axis] && p[y_axis] <= std::max(a[y_axis], b[y_axis]);
+		}
+
+		/*
+			二维线段ab与cd是否相交（包括端点接触与共线重叠）
+		*/
+		inline bool SegmentsIntersect2D(const double* a, const double* b, const double* c, const double* d, int x_axis, int y_axis) {
+			int d1 = Orient2D(c, d, a, x_axis, y_axis);
+			int d2 = Orient2D(c, d, b, x_axis, y_axis);
+			int d3 = Orient2D(a, b, c, x_axis, y_axis);
+			int d4 = Orient2D(a, b, d, x_axis, y_axis);
+
+			if (d1 * d2 < 0 && d3 * d4 < 0) {
+				return true;
+			}
+			return (d1 == 0 && OnSegment2D(c, d, a, x_axis, y_axis)) || (d2 == 0 && OnSegment2D(c, d, b, x_axis, y_axis))
+				|| (d3 == 0 && OnSegment2D(a, b, c, x_axis, y_axis)) || (d4 == 0 && OnSegment2D(a, b, d, x_axis, y_axis));
+		}
+
+		/*
+			与三角形t共面的线段ab是否与t相交：投影到t的法向分量最大的一维之外的两维上判断
+		*/
+		inline bool CoplanarSegmentIntersectsTriangle(const double* a, const double* b, const double* const t[3]) {
+			double u[3], v[3];
+			for (int i = 0; i < 3; i++) {
+				u[i] = t[1][i] - t[0][i];
+				v[i] = t[2][i] - t[0][i];
+			}
+			double normal[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+
+			int drop_axis = 0;
+			for (int i = 1; i < 3; i++) {
+				if (std::abs(normal[i]) > std::abs(normal[drop_axis])) {
+					drop_axis = i;
+				}
+			}
+			int x_axis = (drop_axis + 1) % 3;
+			int y_axis = (drop_axis + 2) % 3;
+
+			// 端点在三角形内（或边上）
+			for (const double* p : { a, b }) {
+				if (!MixedSigns(Orient2D(t[0], t[1], p, x_axis, y_axis), Orient2D(t[1], t[2], p, x_axis, y_axis), Orient2D(t[2], t[0], p, x_axis, y_axis))) {
+					return true;
+				}
+			}
+
+			// 两个端点都在三角形外时，线段必须与某条边相交
+			for (int j = 0; j < 3; j++) {
+				if (SegmentsIntersect2D(a, b, t[j], t[(j + 1) % 3], x_axis, y_axis)) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/*
+			线段ab是否与三角形t相交，sa、sb为a、b相对t所在平面的Orient3D符号
+		*/
+		inline bool SegmentIntersectsTriangle(const double* a, const double* b, int sa, int sb, const double* const t[3]) {
+			if (sa == 0 && sb == 0) {
+				return CoplanarSegmentIntersectsTriangle(a, b, t);
+			}
+			if (sa == sb) {
+				return false;
+			}
+
+			// 线段穿过（或一端接触）平面：直线ab穿过三角形当且仅当三个符号不相反
+			return !MixedSigns(Orient3D(a, b, t[0], t[1]), Orient3D(a, b, t[1], t[2]), Orient3D(a, b, t[2], t[0]));
+		}
+
+		/*
+			三角形p与q是否相交（包括接触），两个三角形都不能退化
+		*/
+		inline bool TrianglesIntersect(const double* const p[3], const double* const q[3]) {
+			int sq[3], sp[3];
+			for (int i = 0; i < 3; i++) {
+				sq[i] = Orient3D(p[0], p[1], p[2], q[i]);
+			}
+			if ((sq[0] > 0 && sq[1] > 0 && sq[2] > 0) || (sq[0] < 0 && sq[1] < 0 && sq[2] < 0)) {
+				return false;
+			}
+			for (int i = 0; i < 3; i++) {
+				sp[i] = Orient3D(q[0], q[1], q[2], p[i]);
+			}
+			if ((sp[0] > 0 && sp[1] > 0 && sp[2] > 0) || (sp[0] < 0 && sp[1] < 0 && sp[2] < 0)) {
+				return false;
+			}
+
+			for (int j = 0; j < 3; j++) {
+				if (SegmentIntersectsTriangle(p[j], p[(j + 1) % 3], sp[j], sp[(j + 1) % 3], q)) {
+					return true;
+				}
+			}
+			for (int j = 0; j < 3; j++) {
+				if (SegmentIntersectsTriangle(q[j], q[(j + 1) % 3], sq[j], sq[(j + 1) % 3], p)) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+	} // namespace Intersection
+
+} // namespace STLNonManifold
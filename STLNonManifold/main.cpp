@@ -1,5 +1,10 @@
 ﻿
 #include "STLNonManifold.h"
+#include "StreamingChecker.h"
+#include "BatchChecker.h"
+#include "SolidsChecker.h"
+#include "ResultCache.h"
+#include "Benchmark.h"
 #include "argparser.hpp"
 
 
@@ -13,17 +18,138 @@ int main(int argc, char const* argv[])
     args_parser.add_help_option()
         .use_color_error()
         .add_option<std::string>("-o", "--output", "output obj path", "./output_obj.obj")
+        .add_option("", "--obj-shortest", "write obj coordinates in the shortest round-trip form instead of 6 significant digits")
+        .add_option("-m", "--mapped", "read binary stl files through a memory mapped zero-copy view")
+        .add_option<int>("-j", "--threads", "number of threads, 0 uses all hardware threads", 1)
+        .add_option<std::string>("", "--weld", "vertex welding engine: kdtree, grid (spatial hash grid) or morton (Morton-ordered grid, vertices numbered along the Z-curve)", "kdtree")
+        .add_option("", "--reorient", "make the triangle orientation consistent in every connected component before the obj export")
+        .add_option("", "--shells", "label the connected shells and report the triangle count, bounding box and defects of each")
+        .add_option("", "--shell-obj", "with --shells: also export every shell to its own obj named after -o (output_obj_shell<N>.obj)")
+        .add_option("", "--self-intersections", "report pairs of triangles without a common vertex that intersect (BVH, on -j threads)")
+        .add_option("-s", "--streaming", "out-of-core check with a fixed memory budget (no obj export)")
+        .add_option<int>("", "--memory-mb", "memory budget of the streaming check in MB", 256)
+        .add_option<std::string>("", "--spill-dir", "directory for temporary files of the streaming check", "")
+        .add_option("", "--per-solid", "weld and check every solid on its own, solids in parallel on -j threads (no obj export)")
+        .add_option("", "--shared-edges", "with --per-solid: also report edges shared between solids")
+        .add_option<std::string>("", "--cache-dir", "cache directory: results of unchanged stl files are read from it instead of checking again (not with -s or --per-solid)", "")
+        .add_option("", "--batch", "check all stl files of a directory, glob (quoted) or manifest file on -j worker threads")
+        .add_option<std::string>("", "--summary", "csv summary path of the batch check", "./batch_summary.csv")
+        .add_option<std::string>("-b", "--benchmark", "run a benchmark instead of checking: load, ascii, dedup, kdtree, weld, topology, intersect, obj, gzip (needs zlib)", "")
+        .add_option<int>("", "--repeats", "benchmark repeats (fastest run is reported)", 3)
         .add_argument<std::string>("stl_model_path", "stl model path")
         .parse(argc, argv);
 
     std::string output_obj_path = args_parser.get_option<std::string>("-o");
     std::string stl_model_path = args_parser.get_argument<std::string>("stl_model_path");
 
+    STLNonManifold::CheckerOptions checker_options;
+    checker_options.mappedBinaryReader = args_parser.get_option<bool>("-m");
+    checker_options.numThreads = static_cast<unsigned int>(std::max(0, args_parser.get_option<int>("-j")));
+    checker_options.memoryBudgetMB = static_cast<size_t>(std::max(1, args_parser.get_option<int>("--memory-mb")));
+    checker_options.spillDirectory = args_parser.get_option<std::string>("--spill-dir");
+    checker_options.cacheDirectory = args_parser.get_option<std::string>("--cache-dir");
+
+    std::string weld_method = args_parser.get_option<std::string>("--weld");
+    if (weld_method == "grid") {
+        checker_options.weldMethod = STLNonManifold::WeldMethod::HASH_GRID;
+    }
+    else if (weld_method == "morton") {
+        checker_options.weldMethod = STLNonManifold::WeldMethod::MORTON;
+    }
+    else if (weld_method != "kdtree") {
+        std::cout << "Unknown weld method: " << weld_method << std::endl;
+        return 1;
+    }
+
+    std::string benchmark_name = args_parser.get_option<std::string>("-b");
+    if (!benchmark_name.empty()) {
+        if (!STLNonManifold::Benchmark::Run(benchmark_name, stl_model_path, checker_options, args_parser.get_option<int>("--repeats"))) {
+            std::cout << "Unknown benchmark: " << benchmark_name << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
     //std::string output_obj_path = "./output_obj.obj";
     //std::string stl_model_path = 
 
 
-    STLNonManifold::STLNonManifoldChecker stlNonManifoldChecker(stl_model_path);
+    if (args_parser.get_option<bool>("--batch")) {
+        // 线程用于同时检查多个文件，单个文件内部单线程读取
+        unsigned int num_workers = stl_reader::stl_reader_impl::ResolveNumThreads(checker_options.numThreads);
+        checker_options.numThreads = 1;
+
+        auto batch_start = std::chrono::steady_clock::now();
+        std::vector<std::string> stl_files = STLNonManifold::Batch::CollectStlFiles(stl_model_path);
+        std::vector<STLNonManifold::Batch::FileResult> results = STLNonManifold::Batch::CheckFiles(stl_files, checker_options, num_workers, args_parser.get_option<bool>("-s"));
+        double wall_time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - batch_start).count();
+
+        STLNonManifold::Batch::WriteSummary(results, args_parser.get_option<std::string>("--summary"));
+        STLNonManifold::Batch::PrintSummary(results, wall_time_ms);
+
+        bool all_ok = std::all_of(results.begin(), results.end(), [](const STLNonManifold::Batch::FileResult& result) { return result.ok; });
+        return all_ok ? 0 : 1;
+    }
+
+    if (args_parser.get_option<bool>("--per-solid")) {
+        STLNonManifold::SolidsNonManifoldChecker solidsChecker(stl_model_path, checker_options);
+        solidsChecker.CheckNonManifold();
+        if (args_parser.get_option<bool>("--shared-edges")) {
+            solidsChecker.FindSharedEdges();
+        }
+        return 0;
+    }
+
+    if (args_parser.get_option<bool>("-s")) {
+        STLNonManifold::StreamingNonManifoldChecker streamingChecker(stl_model_path, checker_options);
+        streamingChecker.CheckNonManifold();
+        return 0;
+    }
+
+    STLNonManifold::ObjFloatFormat obj_float_format = args_parser.get_option<bool>("--obj-shortest") ? STLNonManifold::ObjFloatFormat::SHORTEST : STLNonManifold::ObjFloatFormat::GENERAL_6;
+    bool reorient = args_parser.get_option<bool>("--reorient");
+    bool check_shells = args_parser.get_option<bool>("--shells");
+    bool check_self_intersections = args_parser.get_option<bool>("--self-intersections");
+
+    // 缓存命中时直接由映射的缓存文件输出，跳过读取与构造拓扑
+    // 缓存保存的是原始方向的拓扑，不含壳与自相交，--reorient、--shells或--self-intersections时视为未命中（检查后仍写入缓存）
+    STLNonManifold::Cache::CacheKey cache_key;
+    if (!checker_options.cacheDirectory.empty()) {
+        cache_key = STLNonManifold::Cache::MakeKey(stl_model_path, checker_options);
+        std::string cache_file = STLNonManifold::Cache::CacheFilePath(checker_options.cacheDirectory, cache_key);
+
+        STLNonManifold::Cache::CachedResult cached;
+        if (!reorient && !check_shells && !check_self_intersections && cached.Open(cache_file, cache_key)) {
+            LOG_INFO("Cache hit: %s", cache_file.c_str());
+            cached.CheckNonManifold();
+            cached.CheckNonManifoldVertices();
+            cached.CheckOrientation();
+            cached.Export2OBJ(output_obj_path, obj_float_format);
+            return 0;
+        }
+        LOG_INFO("Cache miss: %s", cache_file.c_str());
+    }
+
+    STLNonManifold::STLNonManifoldChecker stlNonManifoldChecker(stl_model_path, checker_options);
     stlNonManifoldChecker.CheckNonManifold();
-    stlNonManifoldChecker.Export2OBJ(output_obj_path);
+    stlNonManifoldChecker.CheckNonManifoldVertices();
+    stlNonManifoldChecker.CheckOrientation();
+    if (check_shells) {
+        stlNonManifoldChecker.CheckShells();
+    }
+    if (check_self_intersections) {
+        stlNonManifoldChecker.CheckSelfIntersections();
+    }
+
+    if (!checker_options.cacheDirectory.empty()) {
+        STLNonManifold::Cache::Store(STLNonManifold::Cache::CacheFilePath(checker_options.cacheDirectory, cache_key), cache_key, stlNonManifoldChecker);
+    }
+
+    if (reorient) {
+        stlNonManifoldChecker.Reorient();
+    }
+    stlNonManifoldChecker.Export2OBJ(output_obj_path, obj_float_format);
+    if (check_shells && args_parser.get_option<bool>("--shell-obj")) {
+        stlNonManifoldChecker.Export2OBJ_Shells(output_obj_path, obj_float_format);
+    }
 }
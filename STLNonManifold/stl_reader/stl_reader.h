@@ -122,17 +122,46 @@
  * If you do not want to use exceptions, you may define the macro
  * STL_READER_NO_EXCEPTIONS before including 'stl_reader.h'. In that case,
  * functions will return `false` if an error occurred.
+ *
+ * Gzip compressed stl files (e.g. 'geometry.stl.gz') are read by `ReadStlFile`
+ * and `StlMesh` if the macro STL_READER_WITH_ZLIB is defined before including
+ * 'stl_reader.h' and the program is linked against zlib.
  */
 
 #ifndef __H__STL_READER
 #define __H__STL_READER
 
 #include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <fstream>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
+#ifdef _WIN32
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+#ifdef STL_READER_WITH_ZLIB
+#	include <condition_variable>
+#	include <mutex>
+#	include <zlib.h>
+#endif
+
 #ifdef STL_READER_NO_EXCEPTIONS
 #define STL_READER_THROW(msg) return false;
 #define STL_READER_COND_THROW(cond, msg) if(cond) return false;
@@ -153,7 +182,10 @@ namespace stl_reader {
 	 * provides the triangle ranges for individual solids.
 	 *
 	 * Double vertex entries are removed on the fly, so that triangle corners with
-	 * equal coordinates are represented by a single coordinate entry in coordsOut.
+	 * equal coordinates are represented by a single coordinate entry in coordsOut
+	 * (unless removeDoubles is false).
+	 *
+	 * Gzip compressed files are passed on to `ReadStlFile_GZIP`.
 	 *
 	 *
 	 * \param filename  [in] The name of the file which shall be read
@@ -186,6 +218,16 @@ namespace stl_reader {
 	 *                              The type TIndexContainer should have the same interface
 	 *                              as std::vector<size_t>.
 	 *
+	 * \param numThreads  [in] Number of threads used to parse ASCII files and to sort
+	 *                         the corners for removing doubles. Pass 0 to use all
+	 *                         hardware threads. The result does not depend on it.
+	 *
+	 * \param removeDoubles  [in] If false, corners with equal coordinates are not merged
+	 *                            and the triangles are returned as a raw triangle soup:
+	 *                            corner ci of triangle ti is the vertex 3 * ti + ci. This
+	 *                            skips sorting all corners. Triangles with two equal
+	 *                            corners are removed in both cases.
+	 *
 	 * \returns true if the file was successfully read into the provided container.
 	 */
 	template <class TNumberContainer1, class TNumberContainer2,
@@ -194,16 +236,45 @@ namespace stl_reader {
 			TNumberContainer1& coordsOut,
 			TNumberContainer2& normalsOut,
 			TIndexContainer1& trisOut,
-			TIndexContainer2& solidRangesOut);
+			TIndexContainer2& solidRangesOut,
+			const unsigned int numThreads = 1,
+			const bool removeDoubles = true);
 
 
 	/// Reads an ASCII stl file into several arrays
-	/** \copydetails ReadStlFile
-	 * \sa ReadStlFile, ReadStlFile_ASCII
+	/** The file is memory mapped and scanned in place: lines are located with
+	 * `memchr`, keywords are compared through pointer arithmetic and numbers are
+	 * converted with `std::from_chars`. The output is the same as the one of
+	 * `ReadStlFile_ASCII_Stream`.
+	 *
+	 * If more than one thread is requested, the file is split into byte ranges
+	 * which start at `facet` lines. Each range is parsed on its own thread into
+	 * local buffers, which are then concatenated in file order, so triangle order
+	 * and solid ranges are exactly the same as in a serial parse.
+	 *
+	 * \copydetails ReadStlFile
+	 * \sa ReadStlFile, ReadStlFile_ASCII, ReadStlFile_ASCII_Stream
 	 */
 	template <class TNumberContainer1, class TNumberContainer2,
 		class TIndexContainer1, class TIndexContainer2>
 		bool ReadStlFile_ASCII(const char* filename,
+			TNumberContainer1& coordsOut,
+			TNumberContainer2& normalsOut,
+			TIndexContainer1& trisOut,
+			TIndexContainer2& solidRangesOut,
+			const unsigned int numThreads = 1,
+			const bool removeDoubles = true);
+
+	/// Reads an ASCII stl file line by line through `std::istringstream` and `atof`
+	/** This is the original ASCII reader. It is considerably slower than
+	 * `ReadStlFile_ASCII` and is kept as a reference implementation.
+	 *
+	 * \copydetails ReadStlFile
+	 * \sa ReadStlFile, ReadStlFile_ASCII
+	 */
+	template <class TNumberContainer1, class TNumberContainer2,
+		class TIndexContainer1, class TIndexContainer2>
+		bool ReadStlFile_ASCII_Stream(const char* filename,
 			TNumberContainer1& coordsOut,
 			TNumberContainer2& normalsOut,
 			TIndexContainer1& trisOut,
@@ -220,7 +291,36 @@ namespace stl_reader {
 			TNumberContainer1& coordsOut,
 			TNumberContainer2& normalsOut,
 			TIndexContainer1& trisOut,
-			TIndexContainer2& solidRangesOut);
+			TIndexContainer2& solidRangesOut,
+			const unsigned int numThreads = 1,
+			const bool removeDoubles = true);
+
+	/// Reads a gzip compressed ASCII or binary stl file into several arrays
+	/** The file is inflated by `GzipBlockReader` on a background thread, block by
+	 * block. Each block is parsed while the following blocks are inflated; no
+	 * temporary file is written and the decompressed file is never held in memory
+	 * as a whole. The output is the same as the one of `ReadStlFile_ASCII` or
+	 * `ReadStlFile_BINARY` for the decompressed file.
+	 *
+	 * Requires zlib: define STL_READER_WITH_ZLIB before including 'stl_reader.h'.
+	 * Otherwise reading a gzip compressed file fails with an error.
+	 *
+	 * \copydetails ReadStlFile
+	 * \sa ReadStlFile, GzipBlockReader
+	 */
+	template <class TNumberContainer1, class TNumberContainer2,
+		class TIndexContainer1, class TIndexContainer2>
+		bool ReadStlFile_GZIP(const char* filename,
+			TNumberContainer1& coordsOut,
+			TNumberContainer2& normalsOut,
+			TIndexContainer1& trisOut,
+			TIndexContainer2& solidRangesOut,
+			const unsigned int numThreads = 1,
+			const bool removeDoubles = true);
+
+	/// Determines whether a file is gzip compressed
+	/** Checks whether the file starts with the gzip magic bytes 0x1f 0x8b.*/
+	inline bool StlFileIsGzip(const char* filename);
 
 	/// Determines whether a stl file has ASCII format
 	/** The underlying mechanism is simply checks whether the provided file starts
@@ -230,6 +330,192 @@ namespace stl_reader {
 	inline bool StlFileHasASCIIFormat(const char* filename);
 
 
+	/// read-only memory mapping of a whole file
+	/** The mapping is released on `close()` or when the object is destroyed.*/
+	class MappedFile {
+	public:
+		MappedFile() {}
+
+		~MappedFile()
+		{
+			close();
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator = (const MappedFile&) = delete;
+
+		/// maps the whole file read-only into memory
+		inline bool open(const char* filename);
+
+		/// releases the mapping
+		inline void close();
+
+		/// returns a pointer to the first byte of the mapped file, or `NULL` if it is empty.
+		const char* data() const
+		{
+			return fileData;
+		}
+
+		/// returns the size of the mapped file in bytes
+		size_t size() const
+		{
+			return fileSize;
+		}
+
+	private:
+		const char* fileData = NULL;
+		size_t      fileSize = 0;
+	};
+
+
+#ifdef STL_READER_WITH_ZLIB
+	/// reads a gzip compressed file as a sequence of decompressed blocks
+	/** A background thread inflates the file into a ring of `NUM_BLOCKS` buffers
+	 * of `BLOCK_SIZE` bytes, so that inflating the next blocks overlaps with
+	 * processing the current one. The thread is stopped on `close()` or when the
+	 * object is destroyed.
+	 */
+	class GzipBlockReader {
+	public:
+		/// size of a single decompressed block in bytes
+		static const size_t BLOCK_SIZE = 1 << 20;
+		/// number of blocks which are inflated ahead of the reader
+		static const size_t NUM_BLOCKS = 4;
+
+		GzipBlockReader() {}
+
+		~GzipBlockReader()
+		{
+			close();
+		}
+
+		GzipBlockReader(const GzipBlockReader&) = delete;
+		GzipBlockReader& operator = (const GzipBlockReader&) = delete;
+
+		/// opens the file and starts inflating it
+		inline bool open(const char* filename);
+
+		/// returns the next decompressed block
+		/** The block stays valid until the next call. Returns false at the end of the
+		 * stream or if inflating failed, in which case `error()` is not empty.*/
+		inline bool next_block(const char*& dataOut, size_t& sizeOut);
+
+		/// returns the error which stopped inflating, or an empty string
+		const std::string& error() const
+		{
+			return errorMessage;
+		}
+
+		/// stops inflating and closes the file
+		inline void close();
+
+	private:
+		inline void inflate_blocks();
+
+		gzFile      file = NULL;
+		std::thread inflateThread;
+
+		std::mutex mutex;
+		std::condition_variable blockReady;
+		std::condition_variable blockFree;
+
+		std::vector<std::vector<char> > blocks;
+		std::vector<size_t> blockSizes;
+		size_t readBlock = 0;
+		size_t numFilled = 0;
+		bool   holdingBlock = false;
+		bool   finished = false;
+		bool   stopping = false;
+		std::string errorMessage;
+	};
+#endif
+
+
+	/// zero-copy view onto the triangle records of a binary stl file
+	/** The file is memory mapped and its size is validated against the number of
+	 * triangles stored in its header, i.e. it has to contain at least
+	 * `80 + 4 + 50 * numTris` bytes. Afterwards normals and corner coordinates are
+	 * read directly from the strided 50-byte records. In contrast to `StlMesh`, no
+	 * intermediate arrays are built and no double vertices are removed, so every
+	 * triangle owns its 3 corners.
+	 *
+	 * Records are not 4-byte aligned, which is why values are copied out instead of
+	 * being returned as pointers.
+	 *
+	 * \todo  support systems with big endianess
+	 */
+	template <class TNumber = float>
+	class StlBinaryView {
+	public:
+		/// size of the file header (80 bytes comment + 4 bytes triangle count)
+		static const size_t HEADER_SIZE = 84;
+		/// size of a single triangle record (normal, 3 corners, 2 bytes attribute)
+		static const size_t RECORD_SIZE = 50;
+
+		/// initializes an empty view
+		StlBinaryView() {}
+
+		/// initializes the view from the binary stl-file specified through filename
+		/** \{ */
+		StlBinaryView(const char* filename)
+		{
+			map_file(filename);
+		}
+
+		StlBinaryView(const std::string& filename)
+		{
+			map_file(filename);
+		}
+		/** \} */
+
+		/// maps the specified binary stl-file and validates its size
+		/** \{ */
+		inline bool map_file(const char* filename);
+
+		bool map_file(const std::string& filename)
+		{
+			return map_file(filename.c_str());
+		}
+		/** \} */
+
+		/// returns the number of triangles in the file
+		size_t num_tris() const
+		{
+			return numTris;
+		}
+
+		/// returns a pointer to the raw 50-byte record of triangle ti
+		const char* tri_record(const size_t ti) const
+		{
+			return file.data() + HEADER_SIZE + ti * RECORD_SIZE;
+		}
+
+		/// writes the 3 coordinates of the corner with index `0<=ci<3` of triangle ti to coordsOut
+		void tri_corner_coords(const size_t ti, const size_t ci, TNumber* coordsOut) const
+		{
+			read_floats(tri_record(ti) + 12 * (ci + 1), coordsOut);
+		}
+
+		/// writes the 3 values of the normal of triangle ti to normalOut
+		void tri_normal(const size_t ti, TNumber* normalOut) const
+		{
+			read_floats(tri_record(ti), normalOut);
+		}
+
+	private:
+		static void read_floats(const char* src, TNumber* dest)
+		{
+			float d[3];
+			memcpy(d, src, sizeof(d));
+			for (size_t i = 0; i < 3; ++i)
+				dest[i] = static_cast<TNumber> (d[i]);
+		}
+
+		MappedFile file;
+		size_t     numTris = 0;
+	};
+
+
 	/// convenience mesh class which makes accessing the stl data more easy
 	template <class TNumber = float, class TIndex = unsigned int>
 	class StlMesh {
@@ -254,39 +540,36 @@ namespace stl_reader {
 		/** \} */
 
 		/// fills the mesh with the contents of the specified stl-file
-		/** \{ */
-		bool read_file(const char* filename)
+		/** `numThreads` is passed on to `ReadStlFile`.
+		 * \{ */
+		bool read_file(const char* filename, const unsigned int numThreads = 1)
 		{
-			bool res = false;
-
-#ifndef STL_READER_NO_EXCEPTIONS
-			try {
-#endif
-
-				res = ReadStlFile(filename, coords, normals, tris, solids);
-
-#ifndef STL_READER_NO_EXCEPTIONS
-			}
-			catch (std::exception& e) {
-#else
-				if (!res) {
-#endif
+			return read_file_impl(filename, numThreads, true);
+		}
 
-					coords.clear();
-					normals.clear();
-					tris.clear();
-					solids.clear();
-					STL_READER_THROW(e.what());
-				}
+		bool read_file(const std::string& filename, const unsigned int numThreads = 1)
+		{
+			return read_file(filename.c_str(), numThreads);
+		}
+		/** \} */
 
-				return res;
-			}
+		/// fills the mesh with the triangles of the specified stl-file as a raw triangle soup
+		/** Corners with equal coordinates are not merged, so that every triangle
+		 * owns 3 vertices: `tri_corner_ind(ti, ci) == 3 * ti + ci`. This skips the
+		 * sort which `read_file` uses to remove double vertices. It is meant for
+		 * callers which merge vertices themselves. Triangles with two equal
+		 * corners are still removed.
+		 * \{ */
+		bool read_file_soup(const char* filename, const unsigned int numThreads = 1)
+		{
+			return read_file_impl(filename, numThreads, false);
+		}
 
-			bool read_file(const std::string& filename)
-			{
-				return read_file(filename.c_str());
-			}
-			/** \} */
+		bool read_file_soup(const std::string& filename, const unsigned int numThreads = 1)
+		{
+			return read_file_soup(filename.c_str(), numThreads);
+		}
+		/** \} */
 
 			/// returns the number of vertices in the mesh
 			size_t num_vrts() const
@@ -402,6 +685,33 @@ namespace stl_reader {
 			}
 
 		private:
+			bool read_file_impl(const char* filename, const unsigned int numThreads, const bool removeDoubles)
+			{
+				bool res = false;
+
+#ifndef STL_READER_NO_EXCEPTIONS
+				try {
+#endif
+
+					res = ReadStlFile(filename, coords, normals, tris, solids, numThreads, removeDoubles);
+
+#ifndef STL_READER_NO_EXCEPTIONS
+				}
+				catch (std::exception& e) {
+#else
+				if (!res) {
+#endif
+
+					coords.clear();
+					normals.clear();
+					tris.clear();
+					solids.clear();
+					STL_READER_THROW(e.what());
+				}
+
+				return res;
+			}
+
 			std::vector<TNumber>  coords;
 			std::vector<TNumber>  normals;
 			std::vector<TIndex>   tris;
@@ -416,6 +726,30 @@ namespace stl_reader {
 
 		namespace stl_reader_impl {
 
+			inline unsigned int ResolveNumThreads(const unsigned int numThreads)
+			{
+				if (numThreads != 0)
+					return numThreads;
+				return std::max(1u, std::thread::hardware_concurrency());
+			}
+
+			// calls func(i) for every i in [0, numTasks), each on its own thread.
+			// Task 0 runs on the calling thread.
+			template <class TFunc>
+			void RunParallel(const size_t numTasks, const TFunc& func)
+			{
+				std::vector<std::thread> threads;
+				threads.reserve(numTasks);
+				for (size_t i = 1; i < numTasks; ++i)
+					threads.emplace_back([&func, i]() { func(i); });
+
+				if (numTasks > 0)
+					func(0);
+
+				for (auto& t : threads)
+					t.join();
+			}
+
 			// a coordinate triple with an additional index. The index is required
 			// for RemoveDoubles, so that triangles can be reindexed properly.
 			template <typename number_t, typename index_t>
@@ -444,8 +778,122 @@ namespace stl_reader {
 				inline number_t operator [] (const size_t i) const { return data[i]; }
 			};
 
+			// maps a floating point number to an unsigned integer with the same order
+			// as operator <. -0 and +0 are mapped to the same key, since they compare equal.
+			template <typename number_t>
+			struct RadixKey {
+				static_assert(std::is_floating_point<number_t>::value, "RadixKey requires a floating point type");
+				typedef typename std::conditional<sizeof(number_t) == 4, uint32_t, uint64_t>::type key_t;
+				static_assert(sizeof(key_t) == sizeof(number_t), "unsupported floating point type");
+
+				static const unsigned int NUM_BITS = sizeof(key_t) * 8;
+
+				static inline key_t Get(const number_t v)
+				{
+					if (v == 0)
+						return key_t(1) << (NUM_BITS - 1);
+
+					key_t bits;
+					memcpy(&bits, &v, sizeof(bits));
+					// negative numbers: flip all bits, positive numbers: flip the sign bit
+					if (bits >> (NUM_BITS - 1))
+						return ~bits;
+					return bits | (key_t(1) << (NUM_BITS - 1));
+				}
+			};
+
+			// sorts coordsWithIndexInOut lexicographically by (x, y, z) with an LSD radix
+			// sort on the keys of RadixKey. It gives the same order of coordinates as
+			// sorting with CoordWithIndex::operator <. Each pass is split into numThreads
+			// contiguous ranges: every thread counts the digits of its range, the counts are
+			// prefix-summed in range order and every thread scatters its range, so the result
+			// does not depend on numThreads.
+			template <typename number_t, typename index_t>
+			void RadixSortCoords(std::vector<CoordWithIndex<number_t, index_t> >& coordsWithIndexInOut,
+				const unsigned int numThreads)
+			{
+				using namespace std;
+				typedef RadixKey<number_t> key_type;
+				typedef typename key_type::key_t key_t;
+
+				// 16 bit digits: two passes per float, the counts of a range still fit into L2
+				const unsigned int DIGIT_BITS = 16;
+				const size_t NUM_BUCKETS = size_t(1) << DIGIT_BITS;
+				// enough elements per thread to make spawning threads worthwhile
+				const size_t MIN_RANGE_SIZE = 1 << 16;
+
+				const size_t n = coordsWithIndexInOut.size();
+				// for small arrays clearing the counts costs more than a comparison sort
+				if (n < MIN_RANGE_SIZE) {
+					sort(coordsWithIndexInOut.begin(), coordsWithIndexInOut.end());
+					return;
+				}
+
+				const size_t numRanges = max<size_t>(1, min<size_t>(ResolveNumThreads(numThreads), n / MIN_RANGE_SIZE));
+				vector<CoordWithIndex<number_t, index_t> > buffer(n);
+				vector<size_t> counts(numRanges * NUM_BUCKETS);
+
+				CoordWithIndex<number_t, index_t>* src = coordsWithIndexInOut.data();
+				CoordWithIndex<number_t, index_t>* dst = buffer.data();
+
+				auto range_begin = [&](const size_t r) { return n * r / numRanges; };
+
+				// least significant component first
+				for (int comp = 2; comp >= 0; --comp) {
+					for (unsigned int shift = 0; shift < key_type::NUM_BITS; shift += DIGIT_BITS) {
+						auto digit = [&](const CoordWithIndex<number_t, index_t>& c) {
+							return static_cast<size_t>((key_type::Get(c[comp]) >> shift) & key_t(NUM_BUCKETS - 1));
+						};
+
+						RunParallel(numRanges, [&](const size_t r) {
+							size_t* rangeCounts = &counts[r * NUM_BUCKETS];
+							fill(rangeCounts, rangeCounts + NUM_BUCKETS, size_t(0));
+							for (size_t i = range_begin(r); i < range_begin(r + 1); ++i)
+								++rangeCounts[digit(src[i])];
+						});
+
+						// all elements share this digit: the pass would not change the order
+						bool trivial = false;
+						for (size_t b = 0; b < NUM_BUCKETS && !trivial; ++b) {
+							size_t total = 0;
+							for (size_t r = 0; r < numRanges; ++r)
+								total += counts[r * NUM_BUCKETS + b];
+							if (total == n)
+								trivial = true;
+							else if (total != 0)
+								break;
+						}
+						if (trivial)
+							continue;
+
+						// turn counts into the start offsets of each (bucket, range)
+						size_t offset = 0;
+						for (size_t b = 0; b < NUM_BUCKETS; ++b) {
+							for (size_t r = 0; r < numRanges; ++r) {
+								const size_t c = counts[r * NUM_BUCKETS + b];
+								counts[r * NUM_BUCKETS + b] = offset;
+								offset += c;
+							}
+						}
+
+						RunParallel(numRanges, [&](const size_t r) {
+							size_t* rangeOffsets = &counts[r * NUM_BUCKETS];
+							for (size_t i = range_begin(r); i < range_begin(r + 1); ++i)
+								dst[rangeOffsets[digit(src[i])]++] = src[i];
+						});
+
+						swap(src, dst);
+					}
+				}
+
+				if (src != coordsWithIndexInOut.data())
+					coordsWithIndexInOut.swap(buffer);
+			}
+
 			// sorts the array coordsWithIndexInOut and copies unique indices to coordsOut.
 			// Triangle-corners are re-indexed on the fly and degenerated triangles are removed.
+			// The array is sorted with RadixSortCoords on numThreads threads, or with the
+			// original comparison sort if radixSort is false. Both give the same output.
 			template <class TNumberContainer1, class TNumberContainer2,
 				class TIndexContainer1, class TIndexContainer2>
 				void RemoveDoubles(TNumberContainer1& uniqueCoordsOut,
@@ -455,14 +903,19 @@ namespace stl_reader {
 					std::vector <CoordWithIndex<
 					typename TNumberContainer1::value_type,
 					typename TIndexContainer1::value_type> >
-					&coordsWithIndexInOut)
+					&coordsWithIndexInOut,
+					const unsigned int numThreads = 1,
+					const bool radixSort = true)
 			{
 				using namespace std;
 
 				typedef typename TNumberContainer1::value_type number_t;
 				typedef typename TIndexContainer1::value_type  index_t;
 
-				sort(coordsWithIndexInOut.begin(), coordsWithIndexInOut.end());
+				if (radixSort)
+					RadixSortCoords(coordsWithIndexInOut, numThreads);
+				else
+					sort(coordsWithIndexInOut.begin(), coordsWithIndexInOut.end());
 
 				//  first count unique indices
 				index_t numUnique = 1;
@@ -533,6 +986,417 @@ namespace stl_reader {
 				using std::swap;
 				swap(solidsInOut, newSolids);
 			}
+
+			// copies the corner coordinates of all triangles to coordsOut without merging
+			// equal coordinates, so that corner j of triangle i becomes vertex 3 * i + j.
+			// As in RemoveDoubles, triangles with two equal corners are removed.
+			template <class TNumberContainer1, class TNumberContainer2,
+				class TIndexContainer1, class TIndexContainer2>
+				void CopyTriangleSoup(TNumberContainer1& coordsOut,
+					TIndexContainer1& trisInOut,
+					TNumberContainer2& normalsInOut,
+					TIndexContainer2& solidsInOut,
+					const std::vector <CoordWithIndex<
+					typename TNumberContainer1::value_type,
+					typename TIndexContainer1::value_type> >
+					&coordsWithIndex)
+			{
+				typedef typename TIndexContainer1::value_type  index_t;
+
+				coordsOut.resize(trisInOut.size() * 3);
+
+				TIndexContainer2 newSolids;
+
+				index_t numSoupTriInds = 0;
+				for (index_t i = 0; i < trisInOut.size(); i += 3) {
+
+					const index_t triInd = i / 3;
+					const index_t newTriInd = numSoupTriInds / 3;
+					if (newSolids.size() < solidsInOut.size() &&
+						solidsInOut[newSolids.size()] <= triInd)
+					{
+						newSolids.push_back(newTriInd);
+					}
+
+					const auto& c0 = coordsWithIndex[trisInOut[i]];
+					const auto& c1 = coordsWithIndex[trisInOut[i + 1]];
+					const auto& c2 = coordsWithIndex[trisInOut[i + 2]];
+
+					if ((c0 != c1) && (c0 != c2) && (c1 != c2)) {
+						for (index_t j = 0; j < 3; ++j)
+						{
+							const auto& c = coordsWithIndex[trisInOut[i + j]];
+							for (index_t k = 0; k < 3; ++k)
+								coordsOut[(numSoupTriInds + j) * 3 + k] = c[k];
+							trisInOut[numSoupTriInds + j] = numSoupTriInds + j;
+							normalsInOut[numSoupTriInds + j] = normalsInOut[i + j];
+						}
+						numSoupTriInds += 3;
+					}
+				}
+
+				if (numSoupTriInds < trisInOut.size())
+				{
+					coordsOut.resize(numSoupTriInds * 3);
+					trisInOut.resize(numSoupTriInds);
+					normalsInOut.resize(numSoupTriInds);
+				}
+
+				if (!newSolids.empty())
+					newSolids.push_back(numSoupTriInds / 3);
+
+				using std::swap;
+				swap(solidsInOut, newSolids);
+			}
+
+			inline bool IsBlank(const char c)
+			{
+				return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+			}
+
+			inline const char* SkipBlanks(const char* p, const char* lineEnd)
+			{
+				while (p != lineEnd && IsBlank(*p))
+					++p;
+				return p;
+			}
+
+			inline const char* SkipToken(const char* p, const char* lineEnd)
+			{
+				while (p != lineEnd && !IsBlank(*p))
+					++p;
+				return p;
+			}
+
+			inline bool TokenEquals(const char* tok, const char* tokEnd, const char* keyword, const size_t keywordLen)
+			{
+				return static_cast<size_t> (tokEnd - tok) == keywordLen && memcmp(tok, keyword, keywordLen) == 0;
+			}
+
+			// converts the next token of the line to a number. Like atof, the number is
+			// parsed as a double first and invalid tokens result in 0.
+			// Returns NULL if the line holds no further token.
+			template <typename number_t>
+			const char* ParseNumber(const char* p, const char* lineEnd, number_t& numberOut)
+			{
+				p = SkipBlanks(p, lineEnd);
+				if (p == lineEnd)
+					return NULL;
+
+				const char* tokEnd = SkipToken(p, lineEnd);
+				const char* numBegin = (*p == '+') ? p + 1 : p;
+
+				double d = 0;
+				if (std::from_chars(numBegin, tokEnd, d).ec != std::errc())
+					d = atof(std::string(p, tokEnd).c_str());
+
+				numberOut = static_cast<number_t> (d);
+				return tokEnd;
+			}
+
+			// 1-based number of the line starting at lineBegin, if the line starting at begin
+			// has the number firstLine. Only used for error messages.
+			inline size_t LineNumber(const char* begin, const char* lineBegin, const size_t firstLine = 1)
+			{
+				return firstLine + static_cast<size_t> (std::count(begin, lineBegin, '\n'));
+			}
+
+			// parses the ASCII stl data in [begin, end) and appends its contents to the
+			// provided containers. Corner coordinates are not merged, every corner gets
+			// the next index in coordsWithIndexInOut. [begin, end) has to start at a line
+			// begin inside the buffer starting at bufferBegin, which is only used to
+			// compute line numbers for error messages. bufferFirstLine is the line number
+			// of bufferBegin in the file.
+			template <typename number_t, typename index_t, class TNumberContainer,
+				class TIndexContainer1, class TIndexContainer2>
+			bool ParseStlBuffer_ASCII(const char* filename,
+				const char* bufferBegin,
+				const char* begin,
+				const char* end,
+				std::vector <CoordWithIndex<number_t, index_t> >& coordsWithIndexInOut,
+				TNumberContainer& normalsInOut,
+				TIndexContainer1& trisInOut,
+				TIndexContainer2& solidRangesInOut,
+				const size_t bufferFirstLine = 1)
+			{
+				typedef typename TNumberContainer::value_type normal_t;
+
+				size_t numFaceVrts = 0;
+
+				const char* lineBegin = begin;
+				while (lineBegin < end)
+				{
+					const char* lineEnd = static_cast<const char*> (memchr(lineBegin, '\n', end - lineBegin));
+					if (lineEnd == NULL)
+						lineEnd = end;
+
+					const char* tok = SkipBlanks(lineBegin, lineEnd);
+					const char* tokEnd = SkipToken(tok, lineEnd);
+
+					if (tok == tokEnd) {
+						// empty line
+					}
+					else if (TokenEquals(tok, tokEnd, "vertex", 6)) {
+						CoordWithIndex <number_t, index_t> c;
+						const char* p = tokEnd;
+						for (size_t i = 0; i < 3 && p != NULL; ++i)
+							p = ParseNumber(p, lineEnd, c[i]);
+
+						STL_READER_COND_THROW(p == NULL,
+							"ERROR while reading from " << filename <<
+							": vertex not specified correctly in line " << LineNumber(bufferBegin, lineBegin, bufferFirstLine));
+
+						c.index = static_cast<index_t>(coordsWithIndexInOut.size());
+						coordsWithIndexInOut.push_back(c);
+						++numFaceVrts;
+					}
+					else if (TokenEquals(tok, tokEnd, "facet", 5))
+					{
+						const char* normalTok = SkipBlanks(tokEnd, lineEnd);
+						const char* normalTokEnd = SkipToken(normalTok, lineEnd);
+						STL_READER_COND_THROW(normalTok == normalTokEnd,
+							"ERROR while reading from " << filename <<
+							": triangle not specified correctly in line " << LineNumber(bufferBegin, lineBegin, bufferFirstLine));
+
+						STL_READER_COND_THROW(!TokenEquals(normalTok, normalTokEnd, "normal", 6),
+							"ERROR while reading from " << filename <<
+							": Missing normal specifier in line " << LineNumber(bufferBegin, lineBegin, bufferFirstLine));
+
+						normal_t n[3];
+						const char* p = normalTokEnd;
+						for (size_t i = 0; i < 3 && p != NULL; ++i)
+							p = ParseNumber(p, lineEnd, n[i]);
+
+						STL_READER_COND_THROW(p == NULL,
+							"ERROR while reading from " << filename <<
+							": triangle not specified correctly in line " << LineNumber(bufferBegin, lineBegin, bufferFirstLine));
+
+						for (size_t i = 0; i < 3; ++i)
+							normalsInOut.push_back(n[i]);
+
+						numFaceVrts = 0;
+					}
+					else if (TokenEquals(tok, tokEnd, "outer", 5)) {
+						const char* loopTok = SkipBlanks(tokEnd, lineEnd);
+						STL_READER_COND_THROW(!TokenEquals(loopTok, SkipToken(loopTok, lineEnd), "loop", 4),
+							"ERROR while reading from " << filename <<
+							": expecting outer loop in line " << LineNumber(bufferBegin, lineBegin, bufferFirstLine));
+					}
+					else if (TokenEquals(tok, tokEnd, "endfacet", 8)) {
+						STL_READER_COND_THROW(numFaceVrts != 3,
+							"ERROR while reading from " << filename <<
+							": bad number of vertices specified for face in line " << LineNumber(bufferBegin, lineBegin, bufferFirstLine));
+
+						trisInOut.push_back(static_cast<index_t> (coordsWithIndexInOut.size() - 3));
+						trisInOut.push_back(static_cast<index_t> (coordsWithIndexInOut.size() - 2));
+						trisInOut.push_back(static_cast<index_t> (coordsWithIndexInOut.size() - 1));
+					}
+					else if (TokenEquals(tok, tokEnd, "solid", 5)) {
+						solidRangesInOut.push_back(static_cast<index_t> (trisInOut.size() / 3));
+					}
+
+					lineBegin = lineEnd + 1;
+				}
+
+				return true;
+			}
+
+			// returns the begin of the first line at or behind p whose first token is
+			// 'facet', or end if there is none.
+			inline const char* FindFacetLine(const char* bufferBegin, const char* p, const char* end)
+			{
+				if (p != bufferBegin && p < end) {
+					p = static_cast<const char*> (memchr(p - 1, '\n', end - (p - 1)));
+					if (p == NULL)
+						return end;
+					++p;
+				}
+
+				while (p < end) {
+					const char* lineEnd = static_cast<const char*> (memchr(p, '\n', end - p));
+					if (lineEnd == NULL)
+						lineEnd = end;
+
+					const char* tok = SkipBlanks(p, lineEnd);
+					if (TokenEquals(tok, SkipToken(tok, lineEnd), "facet", 5))
+						return p;
+
+					p = lineEnd + 1;
+				}
+
+				return end;
+			}
+
+			// contents of a single chunk of an ASCII stl file. Indices are local to the chunk.
+			template <typename number_t, typename index_t, typename normal_t>
+			struct AsciiChunk {
+				std::vector<CoordWithIndex<number_t, index_t> > coordsWithIndex;
+				std::vector<normal_t> normals;
+				std::vector<index_t>  tris;
+				std::vector<index_t>  solids;
+				bool ok = false;
+#ifndef STL_READER_NO_EXCEPTIONS
+				std::exception_ptr error;
+#endif
+			};
+
+			// see StlFileHasASCIIFormat. data holds the first bytes of the file.
+			inline bool StlBufferHasASCIIFormat(const char* data, const size_t size)
+			{
+				std::string buffer(data, std::min<size_t> (size, 256));
+				std::transform(buffer.begin(), buffer.end(), buffer.begin(), ::tolower);
+				return buffer.find("solid") != std::string::npos &&
+					buffer.find("\n") != std::string::npos &&
+					buffer.find("facet") != std::string::npos &&
+					buffer.find("normal") != std::string::npos;
+			}
+
+#ifdef STL_READER_WITH_ZLIB
+			// returns the begin of the last line in [begin, end) whose first token is
+			// 'facet', or NULL if there is none. end has to be a line begin.
+			inline const char* FindLastFacetLine(const char* begin, const char* end)
+			{
+				const char* p = end;
+				while (p > begin) {
+					const char* lineEnd = p - 1;
+					const char* lineBegin = lineEnd;
+					while (lineBegin > begin && lineBegin[-1] != '\n')
+						--lineBegin;
+
+					const char* tok = SkipBlanks(lineBegin, lineEnd);
+					if (TokenEquals(tok, SkipToken(tok, lineEnd), "facet", 5))
+						return lineBegin;
+
+					p = lineBegin;
+				}
+				return NULL;
+			}
+
+			// inflates the gzip compressed ASCII or binary stl file block by block and
+			// appends its contents to the provided containers, like ParseStlBuffer_ASCII.
+			// The data is parsed in pieces which end behind a complete triangle. After
+			// each piece onPiece() is called, which may consume and clear the containers.
+			// For binary files, a solid range begin of 0 is appended first.
+			template <typename number_t, typename index_t, class TNumberContainer,
+				class TIndexContainer1, class TIndexContainer2, class TFunc>
+			bool ParseStlStream_GZIP(const char* filename,
+				std::vector <CoordWithIndex<number_t, index_t> >& coordsWithIndexInOut,
+				TNumberContainer& normalsInOut,
+				TIndexContainer1& trisInOut,
+				TIndexContainer2& solidRangesInOut,
+				const TFunc& onPiece)
+			{
+				using namespace std;
+
+				GzipBlockReader reader;
+				STL_READER_COND_THROW(!reader.open(filename), "Couldnt open file " << filename);
+
+				//  decompressed data which has not been parsed yet
+				vector<char> pending;
+				auto readBlock = [&]() {
+					const char* block;
+					size_t blockSize;
+					if (!reader.next_block(block, blockSize))
+						return false;
+					pending.insert(pending.end(), block, block + blockSize);
+					return true;
+				};
+
+				bool moreBlocks = true;
+				while (moreBlocks && pending.size() < 256)
+					moreBlocks = readBlock();
+				STL_READER_COND_THROW(!reader.error().empty(),
+					"Error while inflating " << reader.error());
+
+				if (StlBufferHasASCIIFormat(pending.data(), pending.size())) {
+					size_t firstLine = 1;
+					while (true) {
+						const char* begin = pending.data();
+						const char* end = begin + pending.size();
+
+						//  parse everything in front of the last facet line, which may
+						//  still be incomplete. The last piece is parsed as a whole.
+						const char* pieceEnd = end;
+						if (moreBlocks) {
+							const char* lineEnd = end;
+							while (lineEnd > begin && lineEnd[-1] != '\n')
+								--lineEnd;
+							pieceEnd = FindLastFacetLine(begin, lineEnd);
+							if (pieceEnd == NULL)
+								pieceEnd = begin;
+						}
+
+						if (pieceEnd > begin) {
+							if (!ParseStlBuffer_ASCII(filename, begin, begin, pieceEnd, coordsWithIndexInOut,
+								normalsInOut, trisInOut, solidRangesInOut, firstLine))
+							{
+								return false;
+							}
+							firstLine += static_cast<size_t> (count(begin, pieceEnd, '\n'));
+							onPiece();
+							pending.erase(pending.begin(), pending.begin() + (pieceEnd - begin));
+						}
+
+						if (!moreBlocks)
+							break;
+						moreBlocks = readBlock();
+					}
+				}
+				else {
+					const size_t HEADER_SIZE = 84;
+					const size_t RECORD_SIZE = 50;
+
+					STL_READER_COND_THROW(pending.size() < HEADER_SIZE,
+						"Error while parsing binary stl header in file " << filename);
+
+					unsigned int numTris = 0;
+					memcpy(&numTris, pending.data() + 80, 4);
+					solidRangesInOut.push_back(0);
+
+					size_t numTrisRead = 0;
+					size_t offset = HEADER_SIZE;
+					while (true) {
+						const size_t numRecords = min<size_t> ((pending.size() - offset) / RECORD_SIZE, numTris - numTrisRead);
+						for (size_t i = 0; i < numRecords; ++i, offset += RECORD_SIZE) {
+							float d[12];
+							memcpy(d, pending.data() + offset, sizeof(d));
+
+							for (int j = 0; j < 3; ++j)
+								normalsInOut.push_back(d[j]);
+
+							for (size_t ivrt = 1; ivrt < 4; ++ivrt) {
+								CoordWithIndex <number_t, index_t> c;
+								for (size_t j = 0; j < 3; ++j)
+									c[j] = d[ivrt * 3 + j];
+								c.index = static_cast<index_t>(coordsWithIndexInOut.size());
+								coordsWithIndexInOut.push_back(c);
+							}
+
+							trisInOut.push_back(static_cast<index_t> (coordsWithIndexInOut.size() - 3));
+							trisInOut.push_back(static_cast<index_t> (coordsWithIndexInOut.size() - 2));
+							trisInOut.push_back(static_cast<index_t> (coordsWithIndexInOut.size() - 1));
+						}
+						numTrisRead += numRecords;
+
+						if (numRecords > 0)
+							onPiece();
+						pending.erase(pending.begin(), pending.begin() + offset);
+						offset = 0;
+
+						if (numTrisRead == numTris || !moreBlocks)
+							break;
+						moreBlocks = readBlock();
+					}
+
+					STL_READER_COND_THROW(numTrisRead < numTris,
+						"Error while parsing trianlge in binary stl file " << filename);
+				}
+
+				STL_READER_COND_THROW(!reader.error().empty(),
+					"Error while inflating " << reader.error());
+				return true;
+			}
+#endif
 		}// end of namespace stl_reader_impl
 
 
@@ -542,18 +1406,159 @@ namespace stl_reader {
 				TNumberContainer1& coordsOut,
 				TNumberContainer2& normalsOut,
 				TIndexContainer1& trisOut,
-				TIndexContainer2& solidRangesOut)
+				TIndexContainer2& solidRangesOut,
+				const unsigned int numThreads,
+				const bool removeDoubles)
 		{
-			if (StlFileHasASCIIFormat(filename))
-				return ReadStlFile_ASCII(filename, coordsOut, normalsOut, trisOut, solidRangesOut);
+			if (StlFileIsGzip(filename))
+				return ReadStlFile_GZIP(filename, coordsOut, normalsOut, trisOut, solidRangesOut, numThreads, removeDoubles);
+			else if (StlFileHasASCIIFormat(filename))
+				return ReadStlFile_ASCII(filename, coordsOut, normalsOut, trisOut, solidRangesOut, numThreads, removeDoubles);
 			else
-				return ReadStlFile_BINARY(filename, coordsOut, normalsOut, trisOut, solidRangesOut);
+				return ReadStlFile_BINARY(filename, coordsOut, normalsOut, trisOut, solidRangesOut, numThreads, removeDoubles);
 		}
 
 
 		template <class TNumberContainer1, class TNumberContainer2,
 			class TIndexContainer1, class TIndexContainer2>
 			bool ReadStlFile_ASCII(const char* filename,
+				TNumberContainer1& coordsOut,
+				TNumberContainer2& normalsOut,
+				TIndexContainer1& trisOut,
+				TIndexContainer2& solidRangesOut,
+				const unsigned int numThreads,
+				const bool removeDoubles)
+		{
+			using namespace std;
+			using namespace stl_reader_impl;
+
+			typedef typename TNumberContainer1::value_type  number_t;
+			typedef typename TNumberContainer2::value_type  normal_t;
+			typedef typename TIndexContainer1::value_type index_t;
+
+			// chunks smaller than this are not worth an own thread
+			const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+			coordsOut.clear();
+			normalsOut.clear();
+			trisOut.clear();
+			solidRangesOut.clear();
+
+			MappedFile file;
+			if (!file.open(filename))
+				return false;
+
+			const char* data = file.data();
+			const char* dataEnd = data + file.size();
+
+			vector<CoordWithIndex <number_t, index_t> > coordsWithIndex;
+
+			const size_t numChunks = min<size_t> (ResolveNumThreads(numThreads), file.size() / MIN_CHUNK_SIZE + 1);
+			if (numChunks <= 1) {
+				// an ASCII facet takes roughly 250 bytes
+				coordsWithIndex.reserve(file.size() / 80);
+
+				if (!ParseStlBuffer_ASCII(filename, data, data, dataEnd,
+					coordsWithIndex, normalsOut, trisOut, solidRangesOut))
+				{
+					return false;
+				}
+			}
+			else {
+				//  split the file into byte ranges which start at 'facet' lines, so that
+				//  no facet is cut. 'solid' lines always end up in front of the facets
+				//  of their solid.
+				vector<const char*> chunkBegins(numChunks + 1, dataEnd);
+				chunkBegins[0] = data;
+				for (size_t i = 1; i < numChunks; ++i) {
+					const char* p = max(chunkBegins[i - 1], data + file.size() / numChunks * i);
+					chunkBegins[i] = FindFacetLine(data, p, dataEnd);
+				}
+
+				vector<AsciiChunk<number_t, index_t, normal_t> > chunks(numChunks);
+				RunParallel(numChunks, [&](const size_t i) {
+					AsciiChunk<number_t, index_t, normal_t>& chunk = chunks[i];
+					chunk.coordsWithIndex.reserve((chunkBegins[i + 1] - chunkBegins[i]) / 80);
+#ifndef STL_READER_NO_EXCEPTIONS
+					try {
+#endif
+						chunk.ok = ParseStlBuffer_ASCII(filename, data, chunkBegins[i], chunkBegins[i + 1],
+							chunk.coordsWithIndex, chunk.normals, chunk.tris, chunk.solids);
+#ifndef STL_READER_NO_EXCEPTIONS
+					}
+					catch (...) {
+						chunk.error = current_exception();
+					}
+#endif
+				});
+
+				//  report the first error in file order
+				vector<size_t> coordOffsets(numChunks + 1, 0);
+				vector<size_t> triOffsets(numChunks + 1, 0);
+				vector<size_t> normalOffsets(numChunks + 1, 0);
+				for (size_t i = 0; i < numChunks; ++i) {
+#ifndef STL_READER_NO_EXCEPTIONS
+					if (chunks[i].error)
+						rethrow_exception(chunks[i].error);
+#endif
+					if (!chunks[i].ok)
+						return false;
+
+					coordOffsets[i + 1] = coordOffsets[i] + chunks[i].coordsWithIndex.size();
+					triOffsets[i + 1] = triOffsets[i] + chunks[i].tris.size() / 3;
+					normalOffsets[i + 1] = normalOffsets[i] + chunks[i].normals.size();
+				}
+
+				//  concatenate the chunks in file order. Indices are shifted by the number
+				//  of corners / triangles of all preceding chunks.
+				coordsWithIndex.resize(coordOffsets[numChunks]);
+				normalsOut.resize(normalOffsets[numChunks]);
+				trisOut.resize(triOffsets[numChunks] * 3);
+
+				RunParallel(numChunks, [&](const size_t i) {
+					AsciiChunk<number_t, index_t, normal_t>& chunk = chunks[i];
+					const index_t coordOffset = static_cast<index_t> (coordOffsets[i]);
+
+					for (size_t j = 0; j < chunk.coordsWithIndex.size(); ++j) {
+						CoordWithIndex <number_t, index_t> c = chunk.coordsWithIndex[j];
+						c.index += coordOffset;
+						coordsWithIndex[coordOffsets[i] + j] = c;
+					}
+
+					for (size_t j = 0; j < chunk.tris.size(); ++j)
+						trisOut[triOffsets[i] * 3 + j] = chunk.tris[j] + coordOffset;
+
+					for (size_t j = 0; j < chunk.normals.size(); ++j)
+						normalsOut[normalOffsets[i] + j] = chunk.normals[j];
+
+					//  release the chunk early, the merged arrays are large
+					vector<CoordWithIndex <number_t, index_t> >().swap(chunk.coordsWithIndex);
+					vector<normal_t>().swap(chunk.normals);
+					vector<index_t>().swap(chunk.tris);
+				});
+
+				for (size_t i = 0; i < numChunks; ++i) {
+					for (size_t j = 0; j < chunks[i].solids.size(); ++j)
+						solidRangesOut.push_back(static_cast<index_t> (chunks[i].solids[j] + triOffsets[i]));
+				}
+			}
+
+			file.close();
+
+			solidRangesOut.push_back(static_cast<index_t> (trisOut.size() / 3));
+
+			if (removeDoubles)
+				RemoveDoubles(coordsOut, trisOut, normalsOut, solidRangesOut, coordsWithIndex, numThreads);
+			else
+				CopyTriangleSoup(coordsOut, trisOut, normalsOut, solidRangesOut, coordsWithIndex);
+
+			return true;
+		}
+
+
+		template <class TNumberContainer1, class TNumberContainer2,
+			class TIndexContainer1, class TIndexContainer2>
+			bool ReadStlFile_ASCII_Stream(const char* filename,
 				TNumberContainer1& coordsOut,
 				TNumberContainer2& normalsOut,
 				TIndexContainer1& trisOut,
@@ -588,7 +1593,7 @@ namespace stl_reader {
 				//  Instead we count the number of tokens using 'tokenCount'.
 				getline(in, buffer);
 
-				// TODO: ȥǰո񡭡
+				// TODO: 去掉前导空格……
 				if (buffer == "") {
 					continue;
 				}
@@ -672,7 +1677,9 @@ namespace stl_reader {
 				TNumberContainer1& coordsOut,
 				TNumberContainer2& normalsOut,
 				TIndexContainer1& trisOut,
-				TIndexContainer2& solidRangesOut)
+				TIndexContainer2& solidRangesOut,
+				const unsigned int numThreads,
+				const bool removeDoubles)
 		{
 			using namespace std;
 			using namespace stl_reader_impl;
@@ -726,9 +1733,263 @@ namespace stl_reader {
 			solidRangesOut.push_back(0);
 			solidRangesOut.push_back(static_cast<index_t> (trisOut.size() / 3));
 
-			RemoveDoubles(coordsOut, trisOut, normalsOut, solidRangesOut, coordsWithIndex);
+			if (removeDoubles)
+				RemoveDoubles(coordsOut, trisOut, normalsOut, solidRangesOut, coordsWithIndex, numThreads);
+			else
+				CopyTriangleSoup(coordsOut, trisOut, normalsOut, solidRangesOut, coordsWithIndex);
+
+			return true;
+		}
+
+
+		inline bool MappedFile::open(const char* filename)
+		{
+			close();
+
+#ifdef _WIN32
+			HANDLE hFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+				OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			STL_READER_COND_THROW(hFile == INVALID_HANDLE_VALUE, "Couldnt open file " << filename);
+
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(hFile, &size)) {
+				CloseHandle(hFile);
+				STL_READER_THROW("Couldnt determine size of file " << filename);
+			}
+
+			if (size.QuadPart > 0) {
+				HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+				const void* view = NULL;
+				if (hMapping != NULL) {
+					view = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+					// the view keeps the mapping alive
+					CloseHandle(hMapping);
+				}
+				if (view == NULL) {
+					CloseHandle(hFile);
+					STL_READER_THROW("Couldnt map file " << filename);
+				}
+				fileData = static_cast<const char*> (view);
+				fileSize = static_cast<size_t> (size.QuadPart);
+			}
+			CloseHandle(hFile);
+#else
+			int fd = ::open(filename, O_RDONLY);
+			STL_READER_COND_THROW(fd < 0, "Couldnt open file " << filename);
+
+			struct stat st;
+			if (fstat(fd, &st) != 0) {
+				::close(fd);
+				STL_READER_THROW("Couldnt determine size of file " << filename);
+			}
+
+			if (st.st_size > 0) {
+				void* view = mmap(NULL, static_cast<size_t> (st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+				if (view == MAP_FAILED) {
+					::close(fd);
+					STL_READER_THROW("Couldnt map file " << filename);
+				}
+				madvise(view, static_cast<size_t> (st.st_size), MADV_SEQUENTIAL);
+				fileData = static_cast<const char*> (view);
+				fileSize = static_cast<size_t> (st.st_size);
+			}
+			// the mapping stays valid after the descriptor is closed
+			::close(fd);
+#endif
+			return true;
+		}
+
+
+		inline void MappedFile::close()
+		{
+			if (fileData != NULL) {
+#ifdef _WIN32
+				UnmapViewOfFile(fileData);
+#else
+				munmap(const_cast<char*> (fileData), fileSize);
+#endif
+			}
+			fileData = NULL;
+			fileSize = 0;
+		}
+
+
+		template <class TNumber>
+		bool StlBinaryView<TNumber>::map_file(const char* filename)
+		{
+			numTris = 0;
+			if (!file.open(filename))
+				return false;
+
+			if (file.size() < HEADER_SIZE) {
+				file.close();
+				STL_READER_THROW("Error while parsing binary stl header in file " << filename);
+			}
+
+			unsigned int numTrisInHeader = 0;
+			memcpy(&numTrisInHeader, file.data() + 80, 4);
+
+			const unsigned long long expectedSize = HEADER_SIZE +
+				static_cast<unsigned long long> (numTrisInHeader) * RECORD_SIZE;
+			if (file.size() < expectedSize) {
+				file.close();
+				STL_READER_THROW("Binary stl file " << filename << " has " << file.size()
+					<< " bytes, but its header announces " << numTrisInHeader
+					<< " triangles (" << expectedSize << " bytes)");
+			}
+
+			numTris = numTrisInHeader;
+			return true;
+		}
+
+
+		template <class TNumberContainer1, class TNumberContainer2,
+			class TIndexContainer1, class TIndexContainer2>
+			bool ReadStlFile_GZIP(const char* filename,
+				TNumberContainer1& coordsOut,
+				TNumberContainer2& normalsOut,
+				TIndexContainer1& trisOut,
+				TIndexContainer2& solidRangesOut,
+				const unsigned int numThreads,
+				const bool removeDoubles)
+		{
+#ifdef STL_READER_WITH_ZLIB
+			using namespace std;
+			using namespace stl_reader_impl;
+
+			typedef typename TNumberContainer1::value_type  number_t;
+			typedef typename TIndexContainer1::value_type index_t;
+
+			coordsOut.clear();
+			normalsOut.clear();
+			trisOut.clear();
+			solidRangesOut.clear();
+
+			vector<CoordWithIndex <number_t, index_t> > coordsWithIndex;
+			if (!ParseStlStream_GZIP(filename, coordsWithIndex, normalsOut, trisOut, solidRangesOut, []() {}))
+				return false;
+
+			solidRangesOut.push_back(static_cast<index_t> (trisOut.size() / 3));
+
+			if (removeDoubles)
+				RemoveDoubles(coordsOut, trisOut, normalsOut, solidRangesOut, coordsWithIndex, numThreads);
+			else
+				CopyTriangleSoup(coordsOut, trisOut, normalsOut, solidRangesOut, coordsWithIndex);
 
 			return true;
+#else
+			(void)coordsOut; (void)normalsOut; (void)trisOut; (void)solidRangesOut;
+			(void)numThreads; (void)removeDoubles;
+			STL_READER_THROW("Cannot read gzip compressed stl file " << filename
+				<< ": stl_reader was compiled without zlib (define STL_READER_WITH_ZLIB)");
+#endif
+		}
+
+
+#ifdef STL_READER_WITH_ZLIB
+		inline bool GzipBlockReader::open(const char* filename)
+		{
+			close();
+
+			file = gzopen(filename, "rb");
+			if (file == NULL)
+				return false;
+			gzbuffer(file, 1 << 18);
+
+			blocks.assign(NUM_BLOCKS, std::vector<char>(BLOCK_SIZE));
+			blockSizes.assign(NUM_BLOCKS, 0);
+			readBlock = 0;
+			numFilled = 0;
+			holdingBlock = false;
+			finished = false;
+			stopping = false;
+			errorMessage.clear();
+
+			inflateThread = std::thread([this]() { inflate_blocks(); });
+			return true;
+		}
+
+		inline void GzipBlockReader::inflate_blocks()
+		{
+			size_t writeBlock = 0;
+			while (true) {
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					blockFree.wait(lock, [this]() { return stopping || numFilled < NUM_BLOCKS; });
+					if (stopping)
+						return;
+				}
+
+				//  the block is neither filled nor held, so it is not touched by the reader
+				const int numBytes = gzread(file, blocks[writeBlock].data(), static_cast<unsigned int> (BLOCK_SIZE));
+
+				std::lock_guard<std::mutex> lock(mutex);
+				if (numBytes <= 0) {
+					int errnum = Z_OK;
+					const char* msg = gzerror(file, &errnum);
+					//  Z_BUF_ERROR: the compressed data ended in the middle of the stream
+					if (numBytes < 0 || (errnum != Z_OK && errnum != Z_STREAM_END))
+						errorMessage = (msg != NULL && msg[0] != '\0') ? msg : "unknown zlib error";
+					finished = true;
+					blockReady.notify_one();
+					return;
+				}
+
+				blockSizes[writeBlock] = static_cast<size_t> (numBytes);
+				writeBlock = (writeBlock + 1) % NUM_BLOCKS;
+				++numFilled;
+				blockReady.notify_one();
+			}
+		}
+
+		inline bool GzipBlockReader::next_block(const char*& dataOut, size_t& sizeOut)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (holdingBlock) {
+				holdingBlock = false;
+				readBlock = (readBlock + 1) % NUM_BLOCKS;
+				--numFilled;
+				blockFree.notify_one();
+			}
+
+			blockReady.wait(lock, [this]() { return numFilled > 0 || finished; });
+			if (numFilled == 0)
+				return false;
+
+			dataOut = blocks[readBlock].data();
+			sizeOut = blockSizes[readBlock];
+			holdingBlock = true;
+			return true;
+		}
+
+		inline void GzipBlockReader::close()
+		{
+			if (inflateThread.joinable()) {
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					stopping = true;
+				}
+				blockFree.notify_one();
+				inflateThread.join();
+			}
+
+			if (file != NULL) {
+				gzclose(file);
+				file = NULL;
+			}
+		}
+#endif
+
+
+		inline bool StlFileIsGzip(const char* filename)
+		{
+			using namespace std;
+			ifstream in(filename, ios::binary);
+			STL_READER_COND_THROW(!in, "Couldnt open file " << filename);
+
+			unsigned char magic[2] = { 0, 0 };
+			in.read(reinterpret_cast<char*> (magic), 2);
+			return in.gcount() == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
 		}
 
 
@@ -740,12 +2001,7 @@ namespace stl_reader {
 
 			char chars[256];
 			in.read(chars, 256);
-			string buffer(chars, in.gcount());
-			transform(buffer.begin(), buffer.end(), buffer.begin(), ::tolower);
-			return buffer.find("solid") != string::npos &&
-				buffer.find("\n") != string::npos &&
-				buffer.find("facet") != string::npos &&
-				buffer.find("normal") != string::npos;
+			return stl_reader_impl::StlBufferHasASCIIFormat(chars, static_cast<size_t> (in.gcount()));
 		}
 
 	} // end of namespace stl_reader